@@ -0,0 +1,78 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varidocument.h"
+#include "varivalue.h"
+
+#include <stdexcept>
+
+namespace {
+
+// A getrawmempool-style verbose RPC reply, about 4MB
+const std::string& rpcPayload()
+{
+    static const std::string json = [] {
+        std::string entries;
+        for (int i = 0; entries.size() < (4 << 20); i++) {
+            entries += i ? "," : "";
+            entries += "\"" + std::string(64, 'a' + i % 26) + "\":{\"vsize\":" + std::to_string(100 + i % 400) +
+                       ",\"weight\":" + std::to_string(400 + i % 1600) + ",\"time\":" + std::to_string(1600000000 + i) +
+                       ",\"height\":700000,\"fees\":{\"base\":0.0000" + std::to_string(1000 + i % 9000) +
+                       ",\"modified\":0.0000" + std::to_string(1000 + i % 9000) + "},\"depends\":[],\"spentby\":[]" +
+                       ",\"bip125-replaceable\":false,\"unbroadcast\":false}";
+        }
+        return "{\"result\":{" + entries + "},\"error\":null,\"id\":1}";
+    }();
+    return json;
+}
+
+template <typename Fn>
+void countAllocations(benchmark::Bench& bench, Fn&& fn)
+{
+    const uint64_t before = benchmark::allocations();
+    fn();
+    bench.counter("allocations", benchmark::allocations() - before, "allocs/op");
+    bench.run(fn);
+}
+
+void ArenaReadHeap(benchmark::Bench& bench)
+{
+    const std::string& json = rpcPayload();
+    bench.bytes(json.size());
+    countAllocations(bench, [&] {
+        UniValue val;
+        if (!val.read(json))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+void ArenaRead(benchmark::Bench& bench)
+{
+    const std::string& json = rpcPayload();
+    bench.bytes(json.size());
+    countAllocations(bench, [&] {
+        VariDocument doc;
+        if (!doc.read(json))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+// The same document read over and over, reusing its first block
+void ArenaReadReuse(benchmark::Bench& bench)
+{
+    const std::string& json = rpcPayload();
+    bench.bytes(json.size());
+    VariDocument doc;
+    countAllocations(bench, [&] {
+        if (!doc.read(json))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+} // namespace
+
+BENCHMARK(ArenaReadHeap);
+BENCHMARK(ArenaRead);
+BENCHMARK(ArenaReadReuse);
@@ -0,0 +1,138 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <malloc.h>
+#include <map>
+#include <new>
+#include <stdio.h>
+
+namespace benchmark {
+
+namespace {
+thread_local uint64_t g_allocations = 0;
+thread_local int64_t g_liveBytes = 0;
+
+void countAlloc(void *p)
+{
+    g_allocations++;
+    g_liveBytes += malloc_usable_size(p);
+}
+
+void countFree(void *p)
+{
+    if (p)
+        g_liveBytes -= malloc_usable_size(p);
+}
+} // namespace
+
+uint64_t allocations()
+{
+    return g_allocations;
+}
+
+int64_t liveBytes()
+{
+    return g_liveBytes;
+}
+
+namespace {
+std::map<std::string, BenchFunction>& benchmarks()
+{
+    static std::map<std::string, BenchFunction> benchmarks_map;
+    return benchmarks_map;
+}
+} // namespace
+
+BenchRunner::BenchRunner(std::string name, BenchFunction func)
+{
+    benchmarks().emplace(std::move(name), std::move(func));
+}
+
+void BenchRunner::RunAll(const std::string& filter)
+{
+    for (const auto& [name, func] : benchmarks()) {
+        if (name.find(filter) == std::string::npos)
+            continue;
+        Bench bench(name);
+        func(bench);
+    }
+}
+
+void Bench::report(double secondsPerIter) const
+{
+    if (m_bytes) {
+        printf("%-40s %14.1f ns/op %10.1f MB/s\n", m_name.c_str(), secondsPerIter * 1e9, m_bytes / secondsPerIter / 1e6);
+    } else {
+        printf("%-40s %14.1f ns/op\n", m_name.c_str(), secondsPerIter * 1e9);
+    }
+}
+
+void Bench::counter(const std::string& what, double value, const std::string& unit) const
+{
+    printf("%-40s %14.1f %s\n", (m_name + " " + what).c_str(), value, unit.c_str());
+}
+
+} // namespace benchmark
+
+// Count every allocation made through operator new. GCC can't tell that
+// these replace the global operators, so it takes the frees below for a
+// mismatch.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t size)
+{
+    if (void *p = malloc(size ? size : 1)) {
+        benchmark::countAlloc(p);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    benchmark::countFree(p);
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    benchmark::countFree(p);
+    free(p);
+}
+
+// Used by std::pmr::new_delete_resource()
+void* operator new(size_t size, std::align_val_t align)
+{
+    const size_t alignment = std::max(static_cast<size_t>(align), sizeof(void*));
+    if (void *p = aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment)) {
+        benchmark::countAlloc(p);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    benchmark::countFree(p);
+    free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    benchmark::countFree(p);
+    free(p);
+}
+
+#pragma GCC diagnostic pop
+
+int main(int argc, char *argv[])
+{
+    benchmark::BenchRunner::RunAll(argc > 1 ? argv[1] : "");
+    return 0;
+}
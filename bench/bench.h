@@ -0,0 +1,89 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIVALUE_BENCH_H__
+#define __VARIVALUE_BENCH_H__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace benchmark {
+
+// Keep the compiler from discarding a computed value
+template <typename T>
+inline void doNotOptimizeAway(const T& val)
+{
+    asm volatile("" : : "r,m"(val) : "memory");
+}
+
+/**
+ * Runs a benchmark body until enough time has passed for a stable reading
+ * and prints the time per iteration, plus throughput if bytes() was set.
+ */
+class Bench
+{
+public:
+    explicit Bench(std::string name) : m_name(std::move(name)) {}
+
+    // Bytes of input handled by one iteration
+    Bench& bytes(uint64_t n) { m_bytes = n; return *this; }
+
+    template <typename Fn>
+    void run(Fn&& fn)
+    {
+        using clock = std::chrono::steady_clock;
+        fn(); // warm up
+        uint64_t iters = 1;
+        while (true) {
+            const auto start = clock::now();
+            for (uint64_t i = 0; i < iters; i++)
+                fn();
+            const std::chrono::duration<double> elapsed = clock::now() - start;
+            if (elapsed.count() >= MIN_TIME || iters >= (uint64_t{1} << 40)) {
+                report(elapsed.count() / iters);
+                return;
+            }
+            iters *= 2;
+        }
+    }
+
+    // Print an extra measurement that isn't a timing, e.g. memory use
+    void counter(const std::string& what, double value, const std::string& unit) const;
+
+private:
+    static constexpr double MIN_TIME = 0.2;
+
+    std::string m_name;
+    uint64_t m_bytes{0};
+
+    void report(double secondsPerIter) const;
+};
+
+// Heap allocations made so far by the calling thread
+uint64_t allocations();
+// Bytes the calling thread has allocated and not yet freed, as sized by
+// the allocator
+int64_t liveBytes();
+
+using BenchFunction = std::function<void(Bench&)>;
+
+class BenchRunner
+{
+public:
+    BenchRunner(std::string name, BenchFunction func);
+
+    // Run every registered benchmark whose name contains filter
+    static void RunAll(const std::string& filter);
+};
+
+} // namespace benchmark
+
+#define BENCHMARK_PASTE2(a, b) a##b
+#define BENCHMARK_PASTE(a, b) BENCHMARK_PASTE2(a, b)
+#define BENCHMARK(n) static benchmark::BenchRunner BENCHMARK_PASTE(bench_, BENCHMARK_PASTE(__LINE__, n))(#n, n);
+
+#endif // __VARIVALUE_BENCH_H__
@@ -0,0 +1,96 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+
+#include <stdexcept>
+
+namespace {
+
+// A cached RPC result of about 10MB: an array of block-like objects
+UniValue makeResult()
+{
+    std::string json = "[";
+    for (int i = 0; json.size() < (10 << 20); i++) {
+        json += (i ? "," : "") + std::string("{\"txid\":\"") + std::string(64, 'a' + i % 26) +
+                "\",\"size\":" + std::to_string(200 + i) + ",\"vout\":[{\"value\":0.5,\"n\":0},{\"value\":1.25,\"n\":1}]}";
+    }
+    UniValue ret;
+    if (!ret.read(json + "]"))
+        throw std::runtime_error("bench input failed to parse");
+    return ret;
+}
+
+// The result, shared so that copies of it are cheap
+const UniValue& cachedResult()
+{
+    static const UniValue val = [] {
+        UniValue ret = makeResult();
+        ret.share();
+        return ret;
+    }();
+    return val;
+}
+
+// Hand the result to a consumer that only reads it
+void CopyRead(benchmark::Bench& bench)
+{
+    const UniValue& result = cachedResult();
+    bench.run([&] {
+        UniValue copy(result);
+        benchmark::doNotOptimizeAway(copy[copy.size() / 2]["size"].get_int64());
+    });
+}
+
+// The same without sharing, which copies the whole tree
+void CopyReadDeep(benchmark::Bench& bench)
+{
+    const UniValue result = makeResult();
+    bench.run([&] {
+        UniValue copy(result);
+        benchmark::doNotOptimizeAway(copy[copy.size() / 2]["size"].get_int64());
+    });
+}
+
+// Hand the result to a consumer that appends an entry to it
+void CopyModify(benchmark::Bench& bench)
+{
+    const UniValue& result = cachedResult();
+    bench.run([&] {
+        UniValue copy(result);
+        copy.push_back(UniValue(UniValue::VOBJ));
+        benchmark::doNotOptimizeAway(copy.size());
+    });
+}
+
+// Rewrite one field of the result in place, as response middleware does
+void CopyEditField(benchmark::Bench& bench)
+{
+    const UniValue& result = cachedResult();
+    bench.run([&] {
+        UniValue copy(result);
+        copy.at(copy.size() / 2).at("size").setInt(0);
+        benchmark::doNotOptimizeAway(copy.size());
+    });
+}
+
+// Keep editing one copy. Only the first edit detaches its path from the
+// cache; the rest copy nothing.
+void EditField(benchmark::Bench& bench)
+{
+    UniValue tree(cachedResult());
+    int64_t n = 0;
+    bench.run([&] {
+        tree.at(tree.size() / 2).at("vout").at(1).at("n").setInt(n++);
+    });
+}
+
+} // namespace
+
+BENCHMARK(CopyRead);
+BENCHMARK(CopyReadDeep);
+BENCHMARK(CopyModify);
+BENCHMARK(CopyEditField);
+BENCHMARK(EditField);
@@ -0,0 +1,121 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+
+#include <stdexcept>
+
+namespace {
+
+size_t countValues(const UniValue& val)
+{
+    size_t count = 1;
+    if (val.isArray() || val.isObject()) {
+        for (const UniValue& child : val.getValues())
+            count += countValues(child);
+    }
+    return count;
+}
+
+// Heap bytes per value held by the tree read from json, plus read speed.
+// Keys are interned if symbols is given, which then already holds them when
+// the memory is measured.
+void readMemory(benchmark::Bench& bench, const std::string& json, VariSymbols *symbols = nullptr)
+{
+    auto read = [&](UniValue& val) { return symbols ? val.read(json, *symbols) : val.read(json); };
+    bench.bytes(json.size()).run([&] {
+        UniValue val;
+        if (!read(val))
+            throw std::runtime_error("bench input failed to parse");
+    });
+
+    const int64_t before = benchmark::liveBytes();
+    UniValue val;
+    read(val);
+    const int64_t bytes = benchmark::liveBytes() - before;
+    bench.counter("bytes", double(bytes) / countValues(val), "/value");
+}
+
+// A block with 2000 transactions, as returned by getblock with verbosity 2
+void MemoryBlock(benchmark::Bench& bench)
+{
+    std::string txs;
+    for (int i = 0; i < 2000; i++) {
+        txs += i ? "," : "";
+        txs += "{\"txid\":\"" + std::string(64, 'a' + i % 26) + "\",\"size\":" + std::to_string(200 + i) +
+               ",\"vin\":[{\"txid\":\"" + std::string(64, 'b') + "\",\"vout\":0,\"sequence\":4294967295}]" +
+               ",\"vout\":[{\"value\":0.5,\"n\":0,\"spent\":false},{\"value\":1.25,\"n\":1,\"spent\":true}]}";
+    }
+    readMemory(bench, "{\"hash\":\"" + std::string(64, '0') + "\",\"height\":700000,\"tx\":[" + txs + "]}");
+}
+
+// A column of small integers
+void MemoryInts(benchmark::Bench& bench)
+{
+    std::string json = "[";
+    for (int i = 0; i < 100000; i++)
+        json += (i ? "," : "") + std::to_string(i % 1000);
+    readMemory(bench, json + "]");
+}
+
+// Flags and gaps
+void MemoryBoolsNulls(benchmark::Bench& bench)
+{
+    std::string json = "[";
+    for (int i = 0; i < 100000; i++)
+        json += (i ? "," : "") + std::string(i % 3 ? (i % 3 == 1 ? "true" : "false") : "null");
+    readMemory(bench, json + "]");
+}
+
+// Records with short string fields
+void MemoryRecords(benchmark::Bench& bench)
+{
+    std::string json = "[";
+    for (int i = 0; i < 20000; i++) {
+        json += i ? "," : "";
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"peer" + std::to_string(i) +
+                "\",\"inbound\":" + (i % 2 ? "true" : "false") + ",\"score\":" + std::to_string(i % 97) + ".5}";
+    }
+    readMemory(bench, json + "]");
+}
+
+// 5000 verbose mempool entries, each with the same keys
+const std::string& txList()
+{
+    static const std::string json = [] {
+        std::string entries = "[";
+        for (int i = 0; i < 5000; i++) {
+            entries += i ? "," : "";
+            entries += "{\"txid\":\"" + std::string(64, 'a' + i % 26) + "\",\"vsize\":" + std::to_string(100 + i % 400) +
+                       ",\"weight\":" + std::to_string(400 + i % 1600) + ",\"time\":" + std::to_string(1600000000 + i) +
+                       ",\"height\":700000,\"descendantcount\":1,\"descendantsize\":" + std::to_string(100 + i % 400) +
+                       ",\"ancestorcount\":1,\"fees\":{\"base\":0.0000" + std::to_string(1000 + i % 9000) +
+                       ",\"modified\":0.0000" + std::to_string(1000 + i % 9000) + "},\"depends\":[],\"spentby\":[]" +
+                       ",\"bip125-replaceable\":false,\"unbroadcast-since-startup\":false}";
+        }
+        return entries + "]";
+    }();
+    return json;
+}
+
+void MemoryTxList(benchmark::Bench& bench)
+{
+    readMemory(bench, txList());
+}
+
+void MemoryTxListInterned(benchmark::Bench& bench)
+{
+    VariSymbols symbols;
+    readMemory(bench, txList(), &symbols);
+}
+
+} // namespace
+
+BENCHMARK(MemoryBlock);
+BENCHMARK(MemoryInts);
+BENCHMARK(MemoryBoolsNulls);
+BENCHMARK(MemoryRecords);
+BENCHMARK(MemoryTxList);
+BENCHMARK(MemoryTxListInterned);
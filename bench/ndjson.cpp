@@ -0,0 +1,50 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+#include "varivalue_ndjson.h"
+
+#include <stdexcept>
+
+namespace {
+
+// Mempool-event style log, about 16MB
+const std::string& eventLog()
+{
+    static const std::string log = [] {
+        std::string s;
+        for (int i = 0; s.size() < (16 << 20); i++) {
+            s += "{\"event\":\"" + std::string(i % 3 ? "added" : "removed") + "\",\"txid\":\"" +
+                 std::string(64, 'a' + i % 26) + "\",\"fee\":0.000" + std::to_string(1000 + i % 9000) +
+                 ",\"vsize\":" + std::to_string(100 + i % 1000) + ",\"depends\":[],\"time\":" +
+                 std::to_string(1600000000 + i) + "}\n";
+        }
+        return s;
+    }();
+    return log;
+}
+
+void readLines(benchmark::Bench& bench, unsigned int threads)
+{
+    const std::string& log = eventLog();
+    bench.bytes(log.size()).run([&] {
+        std::vector<UniValue> values;
+        std::vector<NdjsonError> errors;
+        if (!readNdjson(values, errors, log.data(), log.size(), threads))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+void NdjsonThreads1(benchmark::Bench& bench) { readLines(bench, 1); }
+void NdjsonThreads2(benchmark::Bench& bench) { readLines(bench, 2); }
+void NdjsonThreads4(benchmark::Bench& bench) { readLines(bench, 4); }
+void NdjsonThreadsAll(benchmark::Bench& bench) { readLines(bench, 0); }
+
+} // namespace
+
+BENCHMARK(NdjsonThreads1);
+BENCHMARK(NdjsonThreads2);
+BENCHMARK(NdjsonThreads4);
+BENCHMARK(NdjsonThreadsAll);
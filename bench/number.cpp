@@ -0,0 +1,191 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr int COUNT = 100000;
+
+// An array of COUNT objects with an integer field each
+const UniValue& records()
+{
+    static const UniValue val = [] {
+        std::string json = "[";
+        for (int i = 0; i < COUNT; i++)
+            json += (i ? "," : "") + std::string("{\"n\":") + std::to_string(i * 7919LL - 300000000LL) + "}";
+        UniValue ret;
+        if (!ret.read(json + "]"))
+            throw std::runtime_error("bench input failed to parse");
+        return ret;
+    }();
+    return val;
+}
+
+// An array of COUNT amounts with 8 decimals
+const UniValue& amounts()
+{
+    static const UniValue val = [] {
+        UniValue ret(UniValue::VARR);
+        for (int64_t i = 0; i < COUNT; i++) {
+            UniValue amount;
+            amount.setFixed(i * 104729 % 2100000000000000, 8);
+            ret.push_back(amount);
+        }
+        return ret;
+    }();
+    return val;
+}
+
+void NumberSumInt64(benchmark::Bench& bench)
+{
+    const UniValue& arr = records();
+    bench.run([&] {
+        int64_t sum = 0;
+        for (size_t i = 0; i < arr.size(); i++)
+            sum += arr[i]["n"].get_int64();
+        benchmark::doNotOptimizeAway(sum);
+    });
+}
+
+void NumberBuildWrite(benchmark::Bench& bench)
+{
+    bench.run([&] {
+        UniValue arr(UniValue::VARR);
+        arr.reserve(COUNT);
+        for (int64_t i = 0; i < COUNT; i++)
+            arr.push_back(UniValue(i * 7919 - 300000000));
+        benchmark::doNotOptimizeAway(arr.write());
+    });
+}
+
+// Fee-rate style doubles
+void NumberBuildWriteFloat(benchmark::Bench& bench)
+{
+    bench.run([&] {
+        UniValue arr(UniValue::VARR);
+        arr.reserve(COUNT);
+        for (int i = 0; i < COUNT; i++)
+            arr.push_back(UniValue(i * 0.00001234 + 1.0 / (i + 3)));
+        benchmark::doNotOptimizeAway(arr.write());
+    });
+}
+
+void NumberFixedArray(benchmark::Bench& bench)
+{
+    const UniValue& arr = amounts();
+    std::vector<int64_t> ret;
+    bench.run([&] {
+        arr.get_fixed_array(ret, 8);
+        benchmark::doNotOptimizeAway(ret);
+    });
+}
+
+// The same amounts through double, for comparison
+void NumberFixedViaReal(benchmark::Bench& bench)
+{
+    const UniValue& arr = amounts();
+    bench.run([&] {
+        std::vector<int64_t> ret;
+        ret.reserve(arr.size());
+        for (size_t i = 0; i < arr.size(); i++)
+            ret.push_back(std::llround(arr[i].get_real() * 1e8));
+        benchmark::doNotOptimizeAway(ret);
+    });
+}
+
+// A column of integers, element by element and in bulk
+const UniValue& column()
+{
+    static const UniValue val = [] {
+        std::string json = "[";
+        for (int i = 0; i < COUNT; i++)
+            json += (i ? "," : "") + std::to_string(i * 7919LL % 1000003);
+        UniValue ret;
+        if (!ret.read(json + "]"))
+            throw std::runtime_error("bench input failed to parse");
+        return ret;
+    }();
+    return val;
+}
+
+void NumberColumnLoop(benchmark::Bench& bench)
+{
+    const UniValue& arr = column();
+    std::vector<int64_t> ret;
+    bench.run([&] {
+        ret.clear();
+        for (size_t i = 0; i < arr.size(); i++)
+            ret.push_back(arr[i].get_int64());
+        benchmark::doNotOptimizeAway(ret);
+    });
+}
+
+void NumberColumnInt64(benchmark::Bench& bench)
+{
+    const UniValue& arr = column();
+    std::vector<int64_t> ret;
+    bench.run([&] {
+        arr.get_int64_array(ret);
+        benchmark::doNotOptimizeAway(ret);
+    });
+}
+
+void NumberColumnReal(benchmark::Bench& bench)
+{
+    const UniValue& arr = column();
+    std::vector<double> ret;
+    bench.run([&] {
+        arr.get_real_array(ret);
+        benchmark::doNotOptimizeAway(ret);
+    });
+}
+
+// One get_real() call on a number kept as text
+void NumberGetReal(benchmark::Bench& bench)
+{
+    UniValue val;
+    val.setNumStr("-12345.678901");
+    bench.run([&] {
+        benchmark::doNotOptimizeAway(val.get_real());
+    });
+}
+
+void NumberGetRealExp(benchmark::Bench& bench)
+{
+    UniValue val;
+    val.setNumStr("6.02214076e23");
+    bench.run([&] {
+        benchmark::doNotOptimizeAway(val.get_real());
+    });
+}
+
+// One get_int64() call on a double, which goes through its text
+void NumberGetInt64Float(benchmark::Bench& bench)
+{
+    UniValue val;
+    val.setFloat(1234567.0);
+    bench.run([&] {
+        benchmark::doNotOptimizeAway(val.get_int64());
+    });
+}
+
+} // namespace
+
+BENCHMARK(NumberSumInt64);
+BENCHMARK(NumberBuildWrite);
+BENCHMARK(NumberBuildWriteFloat);
+BENCHMARK(NumberColumnLoop);
+BENCHMARK(NumberColumnInt64);
+BENCHMARK(NumberColumnReal);
+BENCHMARK(NumberFixedArray);
+BENCHMARK(NumberFixedViaReal);
+BENCHMARK(NumberGetReal);
+BENCHMARK(NumberGetRealExp);
+BENCHMARK(NumberGetInt64Float);
@@ -0,0 +1,128 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// n txid-like keys, in a shuffled order to look them up in
+std::vector<std::string> makeKeys(size_t n)
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < n; i++) {
+        char buf[17];
+        snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)(i * 0x9e3779b97f4a7c15ULL));
+        keys.push_back(std::string(buf) + std::string(buf) + std::string(buf) + std::string(buf));
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+    return keys;
+}
+
+template <size_t N>
+void ObjectFind(benchmark::Bench& bench)
+{
+    const std::vector<std::string> keys = makeKeys(N);
+    UniValue obj(UniValue::VOBJ);
+    for (size_t i = 0; i < N; i++)
+        obj.pushKV(keys[i], (uint64_t)i);
+    size_t next = 0;
+    bench.run([&] {
+        benchmark::doNotOptimizeAway(find_value(obj, keys[next]));
+        next = next + 1 == N ? 0 : next + 1;
+    });
+}
+
+// The same lookups in the std::map that used to back objects
+template <size_t N>
+void ObjectFindMap(benchmark::Bench& bench)
+{
+    const std::vector<std::string> keys = makeKeys(N);
+    std::map<std::string, UniValue> obj;
+    for (size_t i = 0; i < N; i++)
+        obj.emplace(keys[i], UniValue((uint64_t)i));
+    size_t next = 0;
+    bench.run([&] {
+        benchmark::doNotOptimizeAway(obj.find(keys[next])->second);
+        next = next + 1 == N ? 0 : next + 1;
+    });
+}
+
+// Overwrite a member through a long literal key, as RPC code does
+void ObjectUpdate(benchmark::Bench& bench)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("bip125-replaceable-descendant-count", 0);
+    int64_t n = 0;
+    const uint64_t before = benchmark::allocations();
+    obj.pushKV("bip125-replaceable-descendant-count", n);
+    bench.counter("allocations", benchmark::allocations() - before, "allocs/op");
+    bench.run([&] {
+        obj.pushKV("bip125-replaceable-descendant-count", n++);
+        benchmark::doNotOptimizeAway(find_value(obj, "bip125-replaceable-descendant-count"));
+    });
+}
+
+const UniValue& thousandKeys()
+{
+    static const UniValue obj = [] {
+        UniValue ret(UniValue::VOBJ);
+        for (const std::string& key : makeKeys(1000))
+            ret.pushKV(key, key);
+        return ret;
+    }();
+    return obj;
+}
+
+// Visit every member of a 1000-key object, copying it out first
+void ObjectIterCopy(benchmark::Bench& bench)
+{
+    const UniValue& obj = thousandKeys();
+    bench.run([&] {
+        size_t sum = 0;
+        const std::vector<std::string> keys = obj.getKeys();
+        const std::vector<UniValue> values = obj.getValues();
+        for (size_t i = 0; i < keys.size(); i++)
+            sum += keys[i].size() + values[i].get_str().size();
+        benchmark::doNotOptimizeAway(sum);
+    });
+}
+
+// The same through items()
+void ObjectIterView(benchmark::Bench& bench)
+{
+    const UniValue& obj = thousandKeys();
+    bench.run([&] {
+        size_t sum = 0;
+        for (const auto& [key, val] : obj.items())
+            sum += key.size() + val.get_str().size();
+        benchmark::doNotOptimizeAway(sum);
+    });
+}
+
+auto ObjectFind10 = ObjectFind<10>;
+auto ObjectFind1k = ObjectFind<1000>;
+auto ObjectFind100k = ObjectFind<100000>;
+auto ObjectFindMap10 = ObjectFindMap<10>;
+auto ObjectFindMap1k = ObjectFindMap<1000>;
+auto ObjectFindMap100k = ObjectFindMap<100000>;
+
+} // namespace
+
+BENCHMARK(ObjectFind10);
+BENCHMARK(ObjectFind1k);
+BENCHMARK(ObjectFind100k);
+BENCHMARK(ObjectFindMap10);
+BENCHMARK(ObjectFindMap1k);
+BENCHMARK(ObjectFindMap100k);
+BENCHMARK(ObjectUpdate);
+BENCHMARK(ObjectIterCopy);
+BENCHMARK(ObjectIterView);
@@ -0,0 +1,43 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+
+#include <stdexcept>
+
+namespace {
+
+// A UTXO dump style array, about 32MB
+const std::string& utxoDump()
+{
+    static const std::string json = [] {
+        std::string s = "[";
+        for (int i = 0; s.size() < (32 << 20); i++) {
+            s += i ? "," : "";
+            s += "{\"txid\":\"" + std::string(64, 'a' + i % 26) + "\",\"vout\":" + std::to_string(i % 4) +
+                 ",\"amount\":" + std::to_string(i % 1000) + ".125,\"script\":\"76a914" + std::string(40, 'f') + "88ac\"}";
+        }
+        return s + "]";
+    }();
+    return json;
+}
+
+void readArray(benchmark::Bench& bench, UniValue::ReadMode mode)
+{
+    const std::string& json = utxoDump();
+    bench.bytes(json.size()).run([&] {
+        UniValue val;
+        if (!val.read(json, mode))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+void ParallelArraySerial(benchmark::Bench& bench) { readArray(bench, UniValue::READ_SEQUENTIAL); }
+void ParallelArray(benchmark::Bench& bench) { readArray(bench, UniValue::READ_PARALLEL); }
+
+} // namespace
+
+BENCHMARK(ParallelArraySerial);
+BENCHMARK(ParallelArray);
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+#include "variparser.h"
+
+#include <stdexcept>
+
+namespace {
+
+// A typical small RPC request, where per-call setup matters most
+const std::string REQUEST = "{\"jsonrpc\":\"2.0\",\"id\":42,\"method\":\"getblockheader\","
+                            "\"params\":[\"000000000000000000024bead8df69990852c202db0e0097c1a12ea637d7e96d\",true]}";
+
+template <typename Fn>
+void readRequests(benchmark::Bench& bench, Fn&& read)
+{
+    const uint64_t before = benchmark::allocations();
+    uint64_t reads = 0;
+    bench.bytes(REQUEST.size()).run([&] {
+        if (!read())
+            throw std::runtime_error("bench input failed to parse");
+        reads++;
+    });
+    bench.counter("allocations", double(benchmark::allocations() - before) / reads, "/read");
+}
+
+void ParserFresh(benchmark::Bench& bench)
+{
+    readRequests(bench, [] {
+        VariParser parser;
+        UniValue val;
+        return parser.read(val, REQUEST);
+    });
+}
+
+void ParserRead(benchmark::Bench& bench)
+{
+    readRequests(bench, [] {
+        UniValue val;
+        return val.read(REQUEST);
+    });
+}
+
+void ParserReuse(benchmark::Bench& bench)
+{
+    VariParser parser;
+    readRequests(bench, [&] {
+        UniValue val;
+        return parser.read(val, REQUEST);
+    });
+}
+
+void ParserReusePooled(benchmark::Bench& bench)
+{
+    VariParser parser(VariParser::NODES_POOLED);
+    UniValue val;
+    readRequests(bench, [&] {
+        return parser.read(val, REQUEST);
+    });
+}
+
+} // namespace
+
+BENCHMARK(ParserFresh);
+BENCHMARK(ParserRead);
+BENCHMARK(ParserReuse);
+BENCHMARK(ParserReusePooled);
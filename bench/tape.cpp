@@ -0,0 +1,109 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+#include "varivalue_tape.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+// A block-like document: 2000 transactions with a few inputs and outputs
+const std::string& blockJson()
+{
+    static const std::string json = [] {
+        std::string txs;
+        for (int i = 0; i < 2000; i++) {
+            txs += i ? "," : "";
+            txs += "{\"txid\":\"" + std::string(64, 'a' + i % 26) + "\",\"size\":" + std::to_string(200 + i) +
+                   ",\"vin\":[{\"txid\":\"" + std::string(64, 'b') + "\",\"vout\":0,\"sequence\":4294967295}]" +
+                   ",\"vout\":[{\"value\":0.5,\"n\":0},{\"value\":1.25,\"n\":1}]}";
+        }
+        return "{\"hash\":\"" + std::string(64, '0') + "\",\"height\":700000,\"tx\":[" + txs + "]}";
+    }();
+    return json;
+}
+
+// A verbose mempool: one object keyed by 20000 txids
+const std::string& mempoolJson()
+{
+    static const std::string json = [] {
+        std::string entries;
+        for (int i = 0; i < 20000; i++) {
+            char txid[65];
+            snprintf(txid, sizeof(txid), "%016llx%016llx%016llx%016llx", (unsigned long long)i * 0x9e3779b97f4a7c15ULL,
+                     (unsigned long long)i, (unsigned long long)~i, (unsigned long long)i * 31);
+            entries += i ? "," : "";
+            entries += "\"" + std::string(txid) + "\":{\"vsize\":" + std::to_string(100 + i % 400) + ",\"time\":" +
+                       std::to_string(1600000000 + i) + ",\"depends\":[]}";
+        }
+        return "{" + entries + "}";
+    }();
+    return json;
+}
+
+void TapeReadValue(benchmark::Bench& bench)
+{
+    const std::string& json = blockJson();
+    bench.bytes(json.size()).run([&] {
+        UniValue val;
+        if (!val.read(json))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+void TapeRead(benchmark::Bench& bench)
+{
+    const std::string& json = blockJson();
+    bench.bytes(json.size()).run([&] {
+        VariTape tape;
+        if (!tape.read(json))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+void TapeReadMempool(benchmark::Bench& bench)
+{
+    const std::string& json = mempoolJson();
+    bench.bytes(json.size()).run([&] {
+        VariTape tape;
+        if (!tape.read(json))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+void TapeWalkValue(benchmark::Bench& bench)
+{
+    UniValue val;
+    val.read(blockJson());
+    bench.run([&] {
+        size_t sum = 0;
+        const UniValue& txs = find_value(val, "tx");
+        for (size_t i = 0; i < txs.size(); i++)
+            sum += find_value(txs[i], "vout").size() + find_value(txs[i], "txid").get_str().size();
+        benchmark::doNotOptimizeAway(sum);
+    });
+}
+
+void TapeWalk(benchmark::Bench& bench)
+{
+    VariTape tape;
+    tape.read(blockJson());
+    bench.run([&] {
+        size_t sum = 0;
+        for (VariTape::Cursor tx = tape.root()["tx"].child(); tx; tx = tx.next())
+            sum += tx["vout"].size() + tx["txid"].get_str().size();
+        benchmark::doNotOptimizeAway(sum);
+    });
+}
+
+} // namespace
+
+BENCHMARK(TapeReadValue);
+BENCHMARK(TapeRead);
+BENCHMARK(TapeReadMempool);
+BENCHMARK(TapeWalkValue);
+BENCHMARK(TapeWalk);
@@ -0,0 +1,91 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+#include "varivalue_utf8.h"
+#include "univalue_utffilter.h"
+
+#include <stdexcept>
+
+namespace {
+
+// Mostly CJK with some ASCII punctuation mixed in
+std::string cjkText(size_t len)
+{
+    const std::string pieces[] = {"\xe4\xb8\xad", "\xe6\x96\x87", "\xe6\x97\xa5", "\xe6\x9c\xac", "\xed\x95\x9c", ", "};
+    std::string s;
+    for (size_t i = 0; s.size() < len; i++)
+        s += pieces[i % 6];
+    return s;
+}
+
+// Mostly 4-byte emoji
+std::string emojiText(size_t len)
+{
+    const std::string pieces[] = {"\xf0\x9f\x98\x80", "\xf0\x9f\x9a\x80", "\xf0\x9f\x8e\x89", " "};
+    std::string s;
+    for (size_t i = 0; s.size() < len; i++)
+        s += pieces[i % 4];
+    return s;
+}
+
+void validate(benchmark::Bench& bench, const std::string& text, Utf8Impl impl)
+{
+    if (!utf8ImplSupported(impl))
+        return;
+    bench.bytes(text.size()).run([&] {
+        benchmark::doNotOptimizeAway(validUtf8(text.data(), text.size(), impl));
+    });
+}
+
+void filter(benchmark::Bench& bench, const std::string& text)
+{
+    std::string out;
+    out.reserve(text.size());
+    bench.bytes(text.size()).run([&] {
+        out.clear();
+        JSONUTF8StringFilter writer(out);
+        for (unsigned char ch : text)
+            writer.push_back(ch);
+        benchmark::doNotOptimizeAway(writer.finalize());
+    });
+}
+
+void readStrings(benchmark::Bench& bench, const std::string& text)
+{
+    std::string json = "[";
+    for (int i = 0; i < 100; i++)
+        json += (i ? ",\"" : "\"") + text + "\"";
+    json += "]";
+    bench.bytes(json.size()).run([&] {
+        UniValue val;
+        if (!val.read(json))
+            throw std::runtime_error("bench input failed to parse");
+    });
+}
+
+void Utf8CjkFilter(benchmark::Bench& bench) { filter(bench, cjkText(1 << 16)); }
+void Utf8CjkScalar(benchmark::Bench& bench) { validate(bench, cjkText(1 << 16), UTF8_SCALAR); }
+void Utf8CjkSSSE3(benchmark::Bench& bench) { validate(bench, cjkText(1 << 16), UTF8_SSSE3); }
+void Utf8CjkAVX2(benchmark::Bench& bench) { validate(bench, cjkText(1 << 16), UTF8_AVX2); }
+void Utf8CjkRead(benchmark::Bench& bench) { readStrings(bench, cjkText(1000)); }
+void Utf8EmojiFilter(benchmark::Bench& bench) { filter(bench, emojiText(1 << 16)); }
+void Utf8EmojiScalar(benchmark::Bench& bench) { validate(bench, emojiText(1 << 16), UTF8_SCALAR); }
+void Utf8EmojiSSSE3(benchmark::Bench& bench) { validate(bench, emojiText(1 << 16), UTF8_SSSE3); }
+void Utf8EmojiAVX2(benchmark::Bench& bench) { validate(bench, emojiText(1 << 16), UTF8_AVX2); }
+void Utf8EmojiRead(benchmark::Bench& bench) { readStrings(bench, emojiText(1000)); }
+
+} // namespace
+
+BENCHMARK(Utf8CjkFilter);
+BENCHMARK(Utf8CjkScalar);
+BENCHMARK(Utf8CjkSSSE3);
+BENCHMARK(Utf8CjkAVX2);
+BENCHMARK(Utf8CjkRead);
+BENCHMARK(Utf8EmojiFilter);
+BENCHMARK(Utf8EmojiScalar);
+BENCHMARK(Utf8EmojiSSSE3);
+BENCHMARK(Utf8EmojiAVX2);
+BENCHMARK(Utf8EmojiRead);
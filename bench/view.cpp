@@ -0,0 +1,79 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "varivalue.h"
+#include "varivalue_view.h"
+
+#include <stdexcept>
+
+namespace {
+
+// An RPC-style reply with 50k entries in both an object and an array, of
+// which only a few are looked at
+const std::string& bigReply()
+{
+    static const std::string json = [] {
+        std::string entries;
+        for (int i = 0; i < 50000; i++) {
+            entries += i ? "," : "";
+            entries += "\"tx" + std::to_string(i) + "\":{\"fee\":0.0000" + std::to_string(i % 10) +
+                       ",\"vsize\":" + std::to_string(100 + i % 400) +
+                       ",\"depends\":[],\"label\":\"payment \\\"" + std::to_string(i) + "\\\"\"}";
+        }
+        std::string list;
+        for (int i = 0; i < 50000; i++)
+            list += (i ? "," : "") + std::to_string(i * 7);
+        return "{\"result\":{\"mempool\":{" + entries + "},\"heights\":[" + list + "]},\"error\":null,\"id\":1}";
+    }();
+    return json;
+}
+
+void ViewReadFindValue(benchmark::Bench& bench)
+{
+    const std::string& json = bigReply();
+    bench.bytes(json.size()).run([&] {
+        UniValue val;
+        if (!val.read(json))
+            throw std::runtime_error("bench input failed to parse");
+        const UniValue& result = find_value(val, "result");
+        const UniValue& mempool = find_value(result, "mempool");
+        benchmark::doNotOptimizeAway(find_value(find_value(mempool, "tx25000"), "vsize").get_int64());
+        benchmark::doNotOptimizeAway(find_value(find_value(mempool, "tx49999"), "fee").get_real());
+        benchmark::doNotOptimizeAway(find_value(result, "heights")[40000].get_int64());
+    });
+}
+
+void ViewLazy(benchmark::Bench& bench)
+{
+    const std::string& json = bigReply();
+    bench.bytes(json.size()).run([&] {
+        VariViewDoc doc(json);
+        const VariView result = doc.root()["result"];
+        const VariView mempool = result["mempool"];
+        benchmark::doNotOptimizeAway(mempool["tx25000"]["vsize"].get_int64());
+        benchmark::doNotOptimizeAway(mempool["tx49999"]["fee"].get_real());
+        benchmark::doNotOptimizeAway(result["heights"][40000].get_int64());
+    });
+}
+
+// Many lookups in the same array, which the offset cache is there for
+void ViewLazyArrayScan(benchmark::Bench& bench)
+{
+    const std::string& json = bigReply();
+    bench.bytes(json.size()).run([&] {
+        VariViewDoc doc(json);
+        const VariView heights = doc.root()["result"]["heights"];
+        int64_t sum = 0;
+        for (size_t i = 0; i < 50000; i += 997)
+            sum += heights[i].get_int64();
+        benchmark::doNotOptimizeAway(sum);
+    });
+}
+
+} // namespace
+
+BENCHMARK(ViewReadFindValue);
+BENCHMARK(ViewLazy);
+BENCHMARK(ViewLazyArrayScan);
@@ -6,9 +6,11 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
+#include <limits>
 #include <map>
 #include <cassert>
 #include <stdexcept>
+#include <thread>
 #include <varivalue.h>
 
 #define BOOST_FIXTURE_TEST_SUITE(a, b)
@@ -398,6 +400,498 @@ BOOST_AUTO_TEST_CASE(univalue_readwrite)
     BOOST_CHECK(!v.read("{} 42"));
 }
 
+BOOST_AUTO_TEST_CASE(univalue_number)
+{
+    UniValue v;
+    BOOST_CHECK(v.read("[-9223372036854775808,9223372036854775807,18446744073709551615,"
+                       "18446744073709551616,-0,0,1.50,1e3,-2147483649,2147483647]"));
+    BOOST_CHECK_EQUAL(v.write(), "[-9223372036854775808,9223372036854775807,18446744073709551615,"
+                                 "18446744073709551616,-0,0,1.50,1e3,-2147483649,2147483647]");
+    BOOST_CHECK_EQUAL(v[0].get_int64(), std::numeric_limits<int64_t>::min());
+    BOOST_CHECK_EQUAL(v[1].get_int64(), std::numeric_limits<int64_t>::max());
+    BOOST_CHECK_THROW(v[2].get_int64(), std::runtime_error);
+    BOOST_CHECK_EQUAL(v[2].get_real(), 18446744073709551615.0);
+    BOOST_CHECK_THROW(v[3].get_int64(), std::runtime_error);
+    BOOST_CHECK_EQUAL(v[4].get_int64(), 0);
+    BOOST_CHECK_EQUAL(v[4].getValStr(), "-0");
+    BOOST_CHECK_THROW(v[6].get_int64(), std::runtime_error);
+    BOOST_CHECK_EQUAL(v[6].get_real(), 1.5);
+    BOOST_CHECK_EQUAL(v[7].get_real(), 1000);
+    BOOST_CHECK_THROW(v[8].get_int(), std::runtime_error);
+    BOOST_CHECK_EQUAL(v[8].get_int64(), -2147483649LL);
+    BOOST_CHECK_EQUAL(v[9].get_int(), 2147483647);
+
+    // Underflow rounds to zero, overflow is an error
+    BOOST_CHECK(v.read("[1e-400,-1e400,0.1,1.7976931348623157e308]"));
+    BOOST_CHECK_EQUAL(v[0].get_real(), 0);
+    BOOST_CHECK_THROW(v[1].get_real(), std::runtime_error);
+    BOOST_CHECK_EQUAL(v[2].get_real(), 0.1);
+    BOOST_CHECK_EQUAL(v[3].get_real(), std::numeric_limits<double>::max());
+
+    BOOST_CHECK(v.setInt(std::numeric_limits<uint64_t>::max()));
+    BOOST_CHECK_EQUAL(v.getValStr(), "18446744073709551615");
+    BOOST_CHECK_THROW(v.get_int64(), std::runtime_error);
+
+    BOOST_CHECK(v.setFloat(3.0));
+    BOOST_CHECK_EQUAL(v.get_int(), 3);
+    BOOST_CHECK(v.setFloat(1e20));
+    BOOST_CHECK_EQUAL(v.getValStr(), "1e+20");
+    BOOST_CHECK_THROW(v.get_int64(), std::runtime_error);
+    BOOST_CHECK(v.setFloat(0.1 + 0.2));
+    BOOST_CHECK_EQUAL(v.getValStr(), "0.30000000000000004");
+    BOOST_CHECK(v.setFloat(-1e-7));
+    BOOST_CHECK_EQUAL(v.getValStr(), "-1e-07");
+
+    // Doubles survive a trip through text
+    for (double d : {1.0 / 3, 5e-324, 2.5e-8, 123456.789, -std::numeric_limits<double>::max()}) {
+        UniValue arr(UniValue::VARR);
+        arr.push_back(d);
+        BOOST_CHECK(v.read(arr.write()));
+        BOOST_CHECK_EQUAL(v[0].get_real(), d);
+    }
+
+    BOOST_CHECK(v.setFloat(1e20));
+    BOOST_CHECK(!v.setFloat(std::numeric_limits<double>::infinity()));
+    BOOST_CHECK(!v.setFloat(std::numeric_limits<double>::quiet_NaN()));
+    BOOST_CHECK_EQUAL(v.get_real(), 1e20);
+}
+
+BOOST_AUTO_TEST_CASE(univalue_num_array)
+{
+    UniValue v;
+    std::vector<int64_t> ints{42};
+    std::vector<double> reals;
+    BOOST_CHECK(v.read("[]"));
+    v.get_int64_array(ints);
+    BOOST_CHECK(ints.empty());
+
+    BOOST_CHECK(v.read("[0,-1,12345678901234,-9223372036854775808,-0,1.5e2]"));
+    v.get_real_array(reals);
+    BOOST_CHECK(reals == std::vector<double>({0, -1, 12345678901234.0, -9223372036854775808.0, 0, 150}));
+    try {
+        v.get_int64_array(ints);
+        BOOST_CHECK(false);
+    } catch (const std::runtime_error& e) {
+        BOOST_CHECK_EQUAL(std::string(e.what()), "JSON integer out of range at array element 5");
+    }
+
+    BOOST_CHECK(v.read("[1,2,\"3\"]"));
+    try {
+        v.get_int64_array(ints);
+        BOOST_CHECK(false);
+    } catch (const std::runtime_error& e) {
+        BOOST_CHECK_EQUAL(std::string(e.what()), "JSON array element 2 is not a number as expected");
+    }
+    BOOST_CHECK(v.read("[1,2,3]"));
+    v.get_int64_array(ints);
+    BOOST_CHECK(ints == std::vector<int64_t>({1, 2, 3}));
+    BOOST_CHECK(v.read("{\"a\":1}"));
+    BOOST_CHECK_THROW(v.get_real_array(reals), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(univalue_fixed)
+{
+    UniValue v;
+    BOOST_CHECK(v.read("[0,1,-1.5,0.00000001,20999999.99999999,1.10000000000,1e-8,1.5E+2,-0.0,"
+                       "92233720368.54775807,-92233720368.54775808,12345678.123456789,"
+                       "92233720368.54775808,1e-9,1.5,\"1\",0.000000015e1]"));
+    BOOST_CHECK_EQUAL(v[0].get_fixed(8), 0);
+    BOOST_CHECK_EQUAL(v[1].get_fixed(8), 100000000);
+    BOOST_CHECK_EQUAL(v[2].get_fixed(8), -150000000);
+    BOOST_CHECK_EQUAL(v[3].get_fixed(8), 1);
+    BOOST_CHECK_EQUAL(v[4].get_fixed(8), 2099999999999999LL);
+    BOOST_CHECK_EQUAL(v[5].get_fixed(8), 110000000);
+    BOOST_CHECK_EQUAL(v[6].get_fixed(8), 1);
+    BOOST_CHECK_EQUAL(v[7].get_fixed(8), 15000000000LL);
+    BOOST_CHECK_EQUAL(v[8].get_fixed(8), 0);
+    BOOST_CHECK_EQUAL(v[9].get_fixed(8), std::numeric_limits<int64_t>::max());
+    BOOST_CHECK_EQUAL(v[10].get_fixed(8), std::numeric_limits<int64_t>::min());
+    BOOST_CHECK_THROW(v[11].get_fixed(8), std::runtime_error);
+    BOOST_CHECK_THROW(v[12].get_fixed(8), std::runtime_error);
+    BOOST_CHECK_THROW(v[13].get_fixed(8), std::runtime_error);
+    BOOST_CHECK_EQUAL(v[14].get_fixed(1), 15);
+    BOOST_CHECK_THROW(v[14].get_fixed(0), std::runtime_error);
+    BOOST_CHECK_THROW(v[15].get_fixed(8), std::runtime_error);
+    BOOST_CHECK_EQUAL(v[16].get_fixed(8), 15);
+    BOOST_CHECK_THROW(v[1].get_fixed(19), std::runtime_error);
+    BOOST_CHECK_THROW(v[1].get_fixed(-1), std::runtime_error);
+
+    // Arrays name the first element that doesn't convert
+    std::vector<int64_t> amounts;
+    try {
+        v.get_fixed_array(amounts, 8);
+        BOOST_CHECK(false);
+    } catch (const std::runtime_error& e) {
+        BOOST_CHECK(std::string(e.what()).find("element 11") != std::string::npos);
+    }
+    BOOST_CHECK(v.read("[1.5,-0.00000001,7]"));
+    v.get_fixed_array(amounts, 8);
+    BOOST_CHECK(amounts == std::vector<int64_t>({150000000, -1, 700000000}));
+    BOOST_CHECK_THROW(v[0].get_fixed_array(amounts, 8), std::runtime_error);
+
+    BOOST_CHECK(v.setFixed(150000000, 8));
+    BOOST_CHECK_EQUAL(v.getValStr(), "1.50000000");
+    BOOST_CHECK(v.setFixed(-1, 8));
+    BOOST_CHECK_EQUAL(v.getValStr(), "-0.00000001");
+    BOOST_CHECK(v.setFixed(std::numeric_limits<int64_t>::min(), 8));
+    BOOST_CHECK_EQUAL(v.getValStr(), "-92233720368.54775808");
+    BOOST_CHECK_EQUAL(v.get_fixed(8), std::numeric_limits<int64_t>::min());
+    BOOST_CHECK(v.setFixed(-42, 0));
+    BOOST_CHECK_EQUAL(v.getValStr(), "-42");
+    BOOST_CHECK(v.setFixed(5, 18));
+    BOOST_CHECK_EQUAL(v.getValStr(), "0.000000000000000005");
+    BOOST_CHECK(!v.setFixed(5, 19));
+
+    // Doubles convert by their shortest text
+    BOOST_CHECK(v.setFloat(0.1));
+    BOOST_CHECK_EQUAL(v.get_fixed(8), 10000000);
+}
+
+BOOST_AUTO_TEST_CASE(univalue_compact)
+{
+    static_assert(sizeof(UniValue) == 16, "UniValue should stay two words");
+
+    // Number text of any length reads back as written, whether or not it
+    // fits inline
+    const char *nums[] = {"0", "-", "1.5", "-0.0", "1e-8", "0.00001234", "1234567890.1234",
+                          "12345678901234.5", "4611686018427387904", "-4611686018427387905",
+                          "1.5E+2", "123456789012345678901234567890"};
+    for (const char *num : nums) {
+        UniValue v;
+        BOOST_CHECK(v.setNumStr(num));
+        UniValue copy(v);
+        BOOST_CHECK_EQUAL(copy.getValStr(), num);
+        BOOST_CHECK_EQUAL(copy.write(), num);
+    }
+    UniValue v;
+    BOOST_CHECK(v.read("[4611686018427387903,-4611686018427387904,4611686018427387904,9223372036854775807]"));
+    BOOST_CHECK_EQUAL(v[0].get_int64(), 4611686018427387903LL);
+    BOOST_CHECK_EQUAL(v[1].get_int64(), -4611686018427387904LL);
+    BOOST_CHECK_EQUAL(v[2].get_int64(), 4611686018427387904LL);
+    BOOST_CHECK_EQUAL(v[3].get_int64(), std::numeric_limits<int64_t>::max());
+
+    // Moving out leaves a null behind
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("a", "b");
+    UniValue moved(std::move(obj));
+    BOOST_CHECK(obj.isNull());
+    BOOST_CHECK_EQUAL(moved["a"].get_str(), "b");
+    moved = std::move(moved["a"]);
+    BOOST_CHECK_EQUAL(moved.get_str(), "b");
+}
+
+BOOST_AUTO_TEST_CASE(univalue_object_order)
+{
+    // Members keep their insertion order rather than being sorted
+    UniValue obj(UniValue::VOBJ);
+    BOOST_CHECK(obj.pushKV("b", 1));
+    BOOST_CHECK(obj.pushKV("a", 2));
+    BOOST_CHECK(obj.pushKV("c", 3));
+    BOOST_CHECK_EQUAL(obj.write(), "{\"b\":1,\"a\":2,\"c\":3}");
+    // Replacing a value leaves the key where it was
+    BOOST_CHECK(obj.pushKV("b", 4));
+    BOOST_CHECK_EQUAL(obj.write(), "{\"b\":4,\"a\":2,\"c\":3}");
+    BOOST_CHECK(obj.getKeys() == std::vector<std::string>({"b", "a", "c"}));
+
+    UniValue more(UniValue::VOBJ);
+    BOOST_CHECK(more.pushKV("z", 5));
+    BOOST_CHECK(more.pushKV("a", 6));
+    BOOST_CHECK(more.pushKV("y", 7));
+    BOOST_CHECK(obj.pushKVs(more));
+    BOOST_CHECK_EQUAL(obj.write(), "{\"b\":4,\"a\":2,\"c\":3,\"z\":5,\"y\":7}");
+
+    UniValue v;
+    BOOST_CHECK(v.read("{\"zeta\":1,\"alpha\":[],\"mid\":{\"y\":0,\"x\":1}}"));
+    BOOST_CHECK_EQUAL(v.write(), "{\"zeta\":1,\"alpha\":[],\"mid\":{\"y\":0,\"x\":1}}");
+
+    // Sorted output orders keys bytewise at every level, as std::map did,
+    // without changing the object
+    BOOST_CHECK(v.pushKV("arr", UniValue(UniValue::VARR)));
+    BOOST_CHECK(v.at("arr").push_back(v["mid"]));
+    BOOST_CHECK(v.pushKV("Zed", "\xc3\xa9"));
+    BOOST_CHECK(v.pushKV("\xc3\xa9", "Zed"));
+    BOOST_CHECK_EQUAL(v.write(0, 0, UniValue::WRITE_SORTED),
+                      "{\"Zed\":\"\xc3\xa9\",\"alpha\":[],\"arr\":[{\"x\":1,\"y\":0}],\"mid\":{\"x\":1,\"y\":0},\"zeta\":1,\"\xc3\xa9\":\"Zed\"}");
+    const std::string pretty = "{\n \"Zed\": \"\xc3\xa9\",\n \"alpha\": [\n ],\n \"arr\": [\n  {\n   \"x\": 1,";
+    BOOST_CHECK_EQUAL(v.write(1, 0, UniValue::WRITE_SORTED).substr(0, pretty.size()), pretty);
+    BOOST_CHECK_EQUAL(v.getKeys().front(), "zeta");
+
+    // Lookups hold up on either side of the size at which objects start
+    // keeping a hash index
+    for (size_t n : {size_t{1}, VariObject::INDEX_THRESHOLD, VariObject::INDEX_THRESHOLD + 1, size_t{1000}}) {
+        UniValue big(UniValue::VOBJ);
+        big.reserve(n);
+        for (size_t i = n; i-- > 0;)
+            BOOST_CHECK(big.pushKV("key" + std::to_string(i), (uint64_t)i));
+        BOOST_CHECK(big.pushKV("key0", 42));
+        BOOST_CHECK_EQUAL(big.size(), n);
+        for (size_t i = 1; i < n; i++)
+            BOOST_CHECK_EQUAL(big["key" + std::to_string(i)].get_int64(), (int64_t)i);
+        BOOST_CHECK_EQUAL(big["key0"].get_int64(), 42);
+        BOOST_CHECK(!big.exists("key" + std::to_string(n)));
+        BOOST_CHECK_EQUAL(big.getKeys().front(), "key" + std::to_string(n - 1));
+
+        UniValue copy(big);
+        BOOST_CHECK_EQUAL(copy["key0"].get_int64(), 42);
+        BOOST_CHECK(v.read(big.write()));
+        BOOST_CHECK_EQUAL(v.write(), big.write());
+        BOOST_CHECK_EQUAL(find_value(v, "key0").get_int64(), 42);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(univalue_object_index)
+{
+    // Keys that differ only past the first word, or only in length
+    VariObject obj;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100; i++)
+        keys.push_back(std::string(i, 'k') + std::to_string(i % 10));
+    for (size_t i = 0; i < keys.size(); i++) {
+        BOOST_CHECK(obj.emplace(VariKey(keys[i]), UniValue((uint64_t)i)).second);
+        BOOST_CHECK(!obj.emplace(VariKey(keys[i / 2]), UniValue()).second);
+    }
+    for (const VariObject& o : {obj, VariObject(obj)}) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            auto it = o.find(std::string_view(keys[i]));
+            BOOST_CHECK(it != o.end() && it - o.begin() == (ptrdiff_t)i);
+            BOOST_CHECK_EQUAL(it->second.get_int64(), (int64_t)i);
+        }
+        // Lookups by a view into a longer buffer
+        const std::string buf = keys[50] + "tail";
+        BOOST_CHECK_EQUAL(o.find(std::string_view(buf).substr(0, keys[50].size()))->second.get_int64(), 50);
+        BOOST_CHECK(o.find(std::string_view(buf)) == o.end());
+        BOOST_CHECK(o.find("") == o.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(univalue_key_lookup)
+{
+    UniValue obj(UniValue::VOBJ);
+    const std::string longKey(100, 'x');
+    const std::string_view buf = "paramsmethod";
+    BOOST_CHECK(obj.pushKV(buf.substr(0, 6), 1));
+    BOOST_CHECK(obj.pushKV(buf.substr(6), "getblock"));
+    BOOST_CHECK(obj.pushKV(longKey, true));
+    BOOST_CHECK(obj.pushKV(std::string_view(longKey), false));
+    BOOST_CHECK_EQUAL(obj.size(), 3);
+    BOOST_CHECK_EQUAL(obj.write(), "{\"params\":1,\"method\":\"getblock\",\"" + longKey + "\":false}");
+
+    // Lookups by literal, std::string and string_view all find the same
+    // members, including by a view that isn't nul-terminated
+    BOOST_CHECK_EQUAL(obj["params"].get_int(), 1);
+    BOOST_CHECK_EQUAL(obj[std::string("params")].get_int(), 1);
+    BOOST_CHECK_EQUAL(obj[buf.substr(0, 6)].get_int(), 1);
+    BOOST_CHECK(obj[buf].isNull());
+    BOOST_CHECK(obj[longKey].isFalse());
+    BOOST_CHECK_EQUAL(find_value(obj, "method").get_str(), "getblock");
+    BOOST_CHECK_EQUAL(find_value(obj, buf.substr(6)).get_str(), "getblock");
+    BOOST_CHECK(obj.exists(buf.substr(6, 4)) == false);
+    BOOST_CHECK(obj.exists(std::string_view(longKey)));
+
+    // Keys built as a std::string can be moved in, as short or long keys,
+    // new or already present. Literal and const char* keys still work.
+    std::string moved = "added-" + longKey;
+    BOOST_CHECK(obj.pushKV(std::move(moved), 2));
+    BOOST_CHECK(obj.pushKV(std::string("params"), "replaced"));
+    BOOST_CHECK(obj.pushKV(std::string("short"), UniValue(UniValue::VARR)));
+    const char *cKey = "method";
+    BOOST_CHECK(obj.pushKV(cKey, 3));
+    obj.__pushKV(std::string(longKey), UniValue());
+    BOOST_CHECK_EQUAL(obj.size(), 5);
+    BOOST_CHECK_EQUAL(obj["added-" + longKey].get_int(), 2);
+    BOOST_CHECK_EQUAL(obj["params"].get_str(), "replaced");
+    BOOST_CHECK(obj["short"].isArray());
+    BOOST_CHECK_EQUAL(obj["method"].get_int(), 3);
+    BOOST_CHECK(obj[longKey].isNull());
+    BOOST_CHECK(!UniValue().pushKV(std::string(longKey), 1));
+
+    // Index access still takes integers
+    UniValue arr(UniValue::VARR);
+    BOOST_CHECK(arr.push_back(7));
+    BOOST_CHECK_EQUAL(arr[0].get_int(), 7);
+}
+
+BOOST_AUTO_TEST_CASE(univalue_shared)
+{
+    UniValue orig;
+    BOOST_CHECK(orig.read("{\"txs\":[{\"id\":1},{\"id\":2}],\"name\":\"a string too long for small string optimization\"}"));
+    const std::string json = orig.write();
+
+    // Copies are deep unless asked for
+    UniValue deep(orig);
+    BOOST_CHECK(&deep["txs"][0] != &orig["txs"][0]);
+    BOOST_CHECK(&deep["name"].get_str() != &orig["name"].get_str());
+
+    // Once shared, copies share their containers until one of them changes
+    orig.share();
+    UniValue copy(orig);
+    BOOST_CHECK(&copy["txs"][0] == &orig["txs"][0]);
+    BOOST_CHECK(&copy["name"].get_str() == &orig["name"].get_str());
+    BOOST_CHECK(copy.pushKV("height", 1));
+    BOOST_CHECK_EQUAL(orig.write(), json);
+    BOOST_CHECK_EQUAL(copy.size(), 3);
+    // Only the changed path is copied
+    BOOST_CHECK(&copy["txs"][0] == &orig["txs"][0]);
+    BOOST_CHECK(orig.pushKV("txs", 0));
+    BOOST_CHECK_EQUAL(copy["txs"][1]["id"].get_int(), 2);
+
+    std::vector<UniValue> values = copy.getValues();
+    BOOST_CHECK(&values[0][0] == &copy["txs"][0]);
+    BOOST_CHECK(values[0].push_back(3));
+    BOOST_CHECK_EQUAL(copy["txs"].size(), 2);
+    BOOST_CHECK_EQUAL(values[0].size(), 3);
+
+    // Threads can copy, read and change their own copies of one tree
+    UniValue shared(copy);
+    shared.share();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&shared, t] {
+            for (int i = 0; i < 1000; i++) {
+                UniValue mine(shared);
+                assert(mine["txs"][1]["id"].get_int() == 2);
+                assert(mine.pushKV("thread", t));
+                assert(mine["thread"].get_int() == t && !shared.exists("thread"));
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    BOOST_CHECK_EQUAL(shared.write(), copy.write());
+}
+
+BOOST_AUTO_TEST_CASE(univalue_views)
+{
+    UniValue v;
+    BOOST_CHECK(v.read("{\"b\":1,\"a\":[true,\"x\",null],\"c\":{}}"));
+
+    std::string keys;
+    for (std::string_view key : v.keys())
+        keys += key;
+    BOOST_CHECK_EQUAL(keys, "bac");
+    BOOST_CHECK_EQUAL(v.keys().size(), 3);
+    BOOST_CHECK(v.keys().begin()->size() == 1);
+
+    size_t n = 0;
+    for (const auto& [key, val] : v.items()) {
+        BOOST_CHECK(&val == &v[key]);
+        BOOST_CHECK(key == v.getKeys()[n++]);
+    }
+    BOOST_CHECK_EQUAL(n, 3);
+
+    std::vector<UniValue::VType> types;
+    for (const UniValue& val : v.values())
+        types.push_back(val.getType());
+    BOOST_CHECK(types == std::vector<UniValue::VType>({UniValue::VNUM, UniValue::VARR, UniValue::VOBJ}));
+
+    // Arrays iterate directly, and through values()
+    const UniValue& arr = v["a"];
+    BOOST_CHECK_EQUAL(arr.end() - arr.begin(), 3);
+    BOOST_CHECK(&*arr.begin() == &arr[0]);
+    BOOST_CHECK(std::next(arr.values().begin(), 2)->isNull());
+    std::string out;
+    for (const UniValue& elem : arr)
+        out += elem.write();
+    for (const UniValue& elem : arr.values())
+        out += elem.write();
+    BOOST_CHECK_EQUAL(out, "true\"x\"nulltrue\"x\"null");
+    BOOST_CHECK(arr.items().empty() && arr.keys().empty());
+
+    // Everything else is empty
+    for (const UniValue& val : {v["b"], v["c"], UniValue(), UniValue("str")}) {
+        BOOST_CHECK(val.begin() == val.end());
+        BOOST_CHECK(val.items().empty() && val.items().begin() == val.items().end());
+        BOOST_CHECK(val.keys().begin() == val.keys().end());
+        BOOST_CHECK(val.values().empty() && val.values().begin() == val.values().end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(univalue_edit)
+{
+    UniValue v;
+    BOOST_CHECK(v.read("{\"result\":{\"tx\":[{\"fee\":1},{\"fee\":2}],\"hex\":\"a string too long for small string optimization\"},\"id\":7}"));
+    const UniValue before(v);
+
+    // Change one field deep inside, without touching the copy
+    BOOST_CHECK(v.at("result").at("tx").at(1).pushKV("fee", 3));
+    v.at("id").setInt(8);
+    BOOST_CHECK_EQUAL(v.write(), "{\"result\":{\"tx\":[{\"fee\":1},{\"fee\":3}],\"hex\":\"a string too long for small string optimization\"},\"id\":8}");
+    BOOST_CHECK_EQUAL(before["result"]["tx"][1]["fee"].get_int(), 2);
+    BOOST_CHECK(&v["result"]["tx"][0] != &before["result"]["tx"][0]);
+
+    // A reference taken before a copy changes only the original, whether
+    // or not the tree is shared
+    for (bool shared : {false, true}) {
+        UniValue a;
+        BOOST_CHECK(a.read("[1,2,{\"k\":[3]}]"));
+        if (shared)
+            a.share();
+        UniValue& r = a.at(0);
+        UniValue b = a;
+        BOOST_CHECK(r.setInt(99));
+        BOOST_CHECK_EQUAL(a.write(), "[99,2,{\"k\":[3]}]");
+        BOOST_CHECK_EQUAL(b.write(), "[1,2,{\"k\":[3]}]");
+
+        UniValue *k = a.at(2).find_mut("k");
+        UniValue snapshot = a;
+        BOOST_CHECK(k->push_back(4));
+        BOOST_CHECK_EQUAL(a.write(), "[99,2,{\"k\":[3,4]}]");
+        BOOST_CHECK_EQUAL(snapshot.write(), "[99,2,{\"k\":[3]}]");
+
+        // Sharing again lets copies share what the references led into
+        a.share();
+        UniValue again = a;
+        BOOST_CHECK(&again[2]["k"][0] == &a[2]["k"][0]);
+    }
+
+    BOOST_CHECK(v.find_mut("result") == &v["result"]);
+    BOOST_CHECK(!v.find_mut("missing"));
+    BOOST_CHECK(!v.at("id").find_mut("id"));
+    BOOST_CHECK_THROW(v.at("missing"), std::runtime_error);
+    BOOST_CHECK_THROW(v.at(0), std::runtime_error);
+    BOOST_CHECK_THROW(v.at("result").at("tx").at(2), std::runtime_error);
+    BOOST_CHECK_THROW(v.at("id").at("x"), std::runtime_error);
+
+    // Moving values out
+    UniValue result = v.take("result");
+    BOOST_CHECK_EQUAL(v.write(), "{\"id\":8}");
+    BOOST_CHECK(v.take("result").isNull());
+    const std::string hex = std::move(result.at("hex")).release_str();
+    BOOST_CHECK_EQUAL(hex, "a string too long for small string optimization");
+    BOOST_CHECK(result["hex"].isNull());
+    std::vector<UniValue> txs = std::move(result.at("tx")).release_array();
+    BOOST_CHECK_EQUAL(txs.size(), 2);
+    BOOST_CHECK_EQUAL(txs[1]["fee"].get_int(), 3);
+    BOOST_CHECK(result["tx"].isNull());
+    BOOST_CHECK_THROW(std::move(result.at("tx")).release_array(), std::runtime_error);
+    BOOST_CHECK_THROW(std::move(v).release_str(), std::runtime_error);
+    BOOST_CHECK_EQUAL(before["result"]["hex"].get_str(), hex);
+
+    // Erasing keeps the order of what remains, with or without an index
+    for (size_t n : {size_t{5}, size_t{100}}) {
+        UniValue obj(UniValue::VOBJ);
+        for (size_t i = 0; i < n; i++)
+            BOOST_CHECK(obj.pushKV("k" + std::to_string(i), (uint64_t)i));
+        BOOST_CHECK(obj.erase("k1"));
+        BOOST_CHECK(!obj.erase("k1"));
+        BOOST_CHECK(obj.erase(std::string("k0")));
+        BOOST_CHECK_EQUAL(obj.size(), n - 2);
+        BOOST_CHECK_EQUAL(obj.getKeys().front(), "k2");
+        for (size_t i = 2; i < n; i++)
+            BOOST_CHECK_EQUAL(obj["k" + std::to_string(i)].get_int64(), (int64_t)i);
+        BOOST_CHECK(obj.pushKV("k0", 0));
+        BOOST_CHECK_EQUAL(obj.getKeys().back(), "k0");
+        BOOST_CHECK(obj.exists("k0") && !obj.exists("k1"));
+    }
+    UniValue arr(UniValue::VARR);
+    std::vector<UniValue> elems{UniValue("a string too long for small string optimization"), UniValue(1), UniValue(2)};
+    BOOST_CHECK(arr.push_backV(std::move(elems)));
+    BOOST_CHECK(arr.erase(1));
+    BOOST_CHECK(!arr.erase(2));
+    BOOST_CHECK(!v.erase(0));
+    BOOST_CHECK_EQUAL(arr.write(), "[\"a string too long for small string optimization\",2]");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 int main (int argc, char *argv[])
@@ -408,6 +902,16 @@ int main (int argc, char *argv[])
     univalue_array();
     univalue_object();
     univalue_readwrite();
+    univalue_number();
+    univalue_num_array();
+    univalue_fixed();
+    univalue_compact();
+    univalue_object_order();
+    univalue_object_index();
+    univalue_key_lookup();
+    univalue_shared();
+    univalue_views();
+    univalue_edit();
     return 0;
 }
 
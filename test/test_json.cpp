@@ -4,17 +4,34 @@
 // It reads JSON input from stdin and exits with code 0 if it can be parsed
 // successfully. It also pretty prints the parsed JSON value to stdout.
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include "varivalue.h"
+#include "variparser.h"
 
 using namespace std;
 
 int main (int argc, char *argv[])
 {
+    const string input{istreambuf_iterator<char>(cin), istreambuf_iterator<char>()};
     UniValue val;
-    if (val.read(string(istreambuf_iterator<char>(cin),
-                        istreambuf_iterator<char>()))) {
+    const bool ok = val.read(input);
+
+    // The same input streamed through the incremental parser in small
+    // chunks must give the same result
+    VariParser parser;
+    bool chunkedOk = true;
+    for (size_t pos = 0; chunkedOk && pos < input.size(); pos += 4096)
+        chunkedOk = parser.feed(input.data() + pos, min<size_t>(4096, input.size() - pos));
+    chunkedOk = chunkedOk && parser.finish();
+    if (chunkedOk != ok || (ok && parser.value().write() != val.write())) {
+        cerr << "VariParser disagrees with read()." << endl;
+        return 2;
+    }
+
+    if (ok) {
         cout << val.write(1 /* prettyIndent */, 4 /* indentLevel */) << endl;
         return 0;
     } else {
@@ -8,6 +8,15 @@
 #include <cassert>
 #include <string>
 #include "varivalue.h"
+#include "varivalue_index.h"
+#include "variparser.h"
+#include "varivalue_sax.h"
+#include "varivalue_view.h"
+#include "varivalue_tape.h"
+#include "varivalue_ndjson.h"
+#include "varidocument.h"
+#include <algorithm>
+#include <stdexcept>
 
 #ifndef JSON_TEST_SRC
 #error JSON_TEST_SRC must point to test source directory
@@ -29,6 +38,63 @@ static std::string rtrim(std::string s)
     return s;
 }
 
+// Walk a lazy view and a parsed value side by side
+static bool viewMatches(const VariView& view, const UniValue& val)
+{
+    if (view.getType() != val.getType())
+        return false;
+    if (val.isObject()) {
+        // Views see duplicate keys, lookups find the first one like read()
+        std::vector<std::string> keys = view.getKeys();
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        if (keys.size() != val.size())
+            return false;
+        for (const std::string& key : keys) {
+            if (!val.exists(key) || !viewMatches(view[key], val[key]))
+                return false;
+        }
+        return true;
+    }
+    if (val.isArray()) {
+        if (view.size() != val.size())
+            return false;
+        for (size_t i = 0; i < val.size(); i++) {
+            if (!viewMatches(view[i], val[i]))
+                return false;
+        }
+        return view[val.size()].isNull();
+    }
+    return view.getValStr() == val.getValStr() && view.value().write() == val.write();
+}
+
+// Walk a tape and a parsed value side by side
+static bool tapeMatches(const VariTape::Cursor& cur, const UniValue& val)
+{
+    if (cur.getType() != val.getType() || cur.getValStr() != val.getValStr())
+        return false;
+    if (val.isObject()) {
+        for (VariTape::Cursor member = cur.child(); member; member = member.next()) {
+            if (!val.exists(std::string(member.key())))
+                return false;
+        }
+        for (const std::string& key : val.getKeys()) {
+            if (!tapeMatches(cur[key], val[key]))
+                return false;
+        }
+    }
+    if (val.isArray()) {
+        if (cur.size() != val.size())
+            return false;
+        size_t i = 0;
+        for (VariTape::Cursor elem = cur.child(); elem; elem = elem.next()) {
+            if (!tapeMatches(elem, val[i++]))
+                return false;
+        }
+    }
+    return true;
+}
+
 static void runtest(std::string filename, const std::string& jdata)
 {
         std::string prefix = filename.substr(0, 4);
@@ -51,6 +117,70 @@ static void runtest(std::string filename, const std::string& jdata)
             std::string odata = val.write(0, 0);
             assert(odata == rtrim(jdata));
         }
+
+        // So must the incremental parser, however the input is split
+        for (size_t chunk : {1, 2, 3, 7, 64, 4096}) {
+            VariParser parser;
+            bool pushResult = true;
+            for (size_t pos = 0; pushResult && pos < jdata.size(); pos += chunk)
+                pushResult = parser.feed(jdata.data() + pos, std::min(chunk, jdata.size() - pos));
+            pushResult = pushResult && parser.finish();
+            d_assert(pushResult == testResult);
+            if (testResult)
+                d_assert(parser.value().write(0, 0) == val.write(0, 0));
+        }
+        for (size_t split = 0; split <= jdata.size(); split++) {
+            VariParser parser;
+            bool pushResult = parser.feed(jdata.data(), split) &&
+                              parser.feed(jdata.data() + split, jdata.size() - split) &&
+                              parser.finish();
+            d_assert(pushResult == testResult);
+        }
+
+        // The event interface validates exactly like read()
+        UniValue saxVal;
+        VariValueBuilder builder(saxVal);
+        d_assert(readSax(builder, jdata.data(), jdata.size()) == testResult);
+        if (testResult)
+            d_assert(saxVal.write(0, 0) == val.write(0, 0));
+
+        // A lazy view of a valid document sees the same values
+        if (testResult) {
+            VariViewDoc doc(jdata);
+            d_assert(viewMatches(doc.root(), val));
+        }
+
+        // And a document in an arena
+        VariDocument vdoc;
+        d_assert(vdoc.read(jdata) == testResult);
+        if (testResult)
+            d_assert(vdoc.root().write(0, 0) == val.write(0, 0));
+
+        // So does a tape, read directly or converted
+        VariTape tape;
+        d_assert(tape.read(jdata) == testResult);
+        if (testResult) {
+            d_assert(tape.toValue().write(0, 0) == val.write(0, 0));
+            d_assert(tapeMatches(tape.root(), val));
+            d_assert(VariTape(val).toValue().write(0, 0) == val.write(0, 0));
+        }
+
+        // The indexed reader must agree with the sequential one exactly
+        UniValue indexedVal;
+        d_assert(indexedVal.read(jdata, UniValue::READ_INDEXED) == testResult);
+        d_assert(indexedVal.write(0, 0) == val.write(0, 0));
+
+        // And every index implementation must agree with the scalar one
+        JsonIndex scalarIndex;
+        d_assert(buildJsonIndex(scalarIndex, jdata.data(), jdata.size(), JSONIDX_SCALAR));
+        for (JsonIndexImpl impl : {JSONIDX_SSE2, JSONIDX_AVX2}) {
+            if (!jsonIndexImplSupported(impl))
+                continue;
+            JsonIndex index;
+            d_assert(buildJsonIndex(index, jdata.data(), jdata.size(), impl));
+            d_assert(index.tokens == scalarIndex.tokens);
+            d_assert(index.dirty == scalarIndex.dirty);
+        }
 }
 
 static void runtest_file(const char *filename_)
@@ -158,6 +288,577 @@ void unescape_unicode_test()
     f_assert(val[0].get_str() == "\xf0\x9d\x85\xa1");
 }
 
+// Long strings mixing plain runs, escapes and multi-byte characters
+void long_string_test()
+{
+    UniValue val;
+    std::string hex;
+    for (int i = 0; i < 100; i++)
+        hex += "0123456789abcdef";
+    f_assert(val.read("[\"" + hex + "\"]"));
+    f_assert(val[0].get_str() == hex);
+    f_assert(val.read("[\"" + hex + "\\n" + hex + "\xc6\x91" + hex + "\"]"));
+    f_assert(val[0].get_str() == hex + "\n" + hex + "\xc6\x91" + hex);
+    f_assert(!val.read("[\"" + hex + "\xc6" + hex + "\"]"));
+    f_assert(!val.read("[\"" + hex + "\\n" + hex + "\x01\"]"));
+    f_assert(!val.read("[\"" + hex + "\\n" + hex));
+}
+
+// Escapes and multi-byte characters cut in half between chunks
+void push_parser_test()
+{
+    const std::string doc = "{\"a\\u00e9\\ud834\\udd61\":[\"\xe4\xb8\xad\xf0\x9f\x98\x80\",-12.5e+3,true,null]}";
+    UniValue expected;
+    f_assert(expected.read(doc));
+    for (size_t split1 = 0; split1 <= doc.size(); split1++) {
+        for (size_t split2 = split1; split2 <= doc.size(); split2++) {
+            VariParser parser;
+            f_assert(parser.feed(doc.data(), split1));
+            f_assert(parser.feed(doc.data() + split1, split2 - split1));
+            f_assert(parser.feed(doc.data() + split2, doc.size() - split2));
+            f_assert(parser.finish());
+            f_assert(parser.value().write() == expected.write());
+        }
+    }
+
+    // Errors are reported as soon as they can't be fixed by more input
+    VariParser parser;
+    f_assert(parser.feed("[1,", 3));
+    f_assert(!parser.feed("]", 1));
+    f_assert(!parser.finish());
+
+    parser.reset();
+    f_assert(parser.feed("[tr", 3));
+    f_assert(!parser.feed("ux]", 3));
+
+    // A complete document followed by more input is an error
+    parser.reset();
+    f_assert(parser.feed("{}  ", 4));
+    f_assert(!parser.feed("{}", 2));
+
+    // Top-level scalars may continue until finish()
+    parser.reset();
+    f_assert(parser.feed("12", 2));
+    f_assert(parser.feed("34", 2));
+    f_assert(parser.finish());
+    f_assert(parser.value().get_int() == 1234);
+
+    parser.reset();
+    f_assert(parser.feed("\"abc", 4));
+    f_assert(!parser.finish());
+}
+
+// A multi-megabyte string fed in small chunks, with escapes and multi-byte
+// characters landing on chunk boundaries. Each chunk must only cost its own
+// length, not that of the string so far.
+void push_parser_long_string_test()
+{
+    std::string str;
+    for (int i = 0; str.size() < (8 << 20); i++)
+        str += i % 61 ? "0123456789abcdef" : "\\\"\\\\\\u00e9\xc6\x91";
+    const std::string doc = "[\"" + str + "\",1]";
+    UniValue expected;
+    f_assert(expected.read(doc));
+
+    for (size_t chunk : {4096, 4099, 65536}) {
+        VariParser parser;
+        for (size_t pos = 0; pos < doc.size(); pos += chunk)
+            f_assert(parser.feed(doc.data() + pos, std::min(chunk, doc.size() - pos)));
+        f_assert(parser.finish());
+        f_assert(parser.value()[0].get_str() == expected[0].get_str());
+        f_assert(parser.value()[1].get_int() == 1);
+    }
+
+    // A control character is still caught in a string that spans chunks
+    VariParser parser;
+    f_assert(parser.feed("[\"" + str.substr(0, 10000)));
+    f_assert(!parser.feed("ab\x01" "cd"));
+}
+
+// Documents that straddle the 64-byte blocks of the structural index
+void indexed_read_test()
+{
+    const std::string fill(61, ' ');
+    const char *docs[] = {
+        "[\"abc\\\\\",\"d\\\"e\"]",
+        "[\"\xe2\x86\x91\",\"\\u2191\",1.5e3,-0,true,false,null]",
+        "{\"a\":[nulltrue]}",
+        "[\"unterminated]",
+        "[1 2]",
+        "[\"a\"\"b\"]",
+        "[\"\\\\\\\\\\\\\\\\\\\"\"]",
+    };
+    for (size_t shift = 0; shift < 70; shift += 3) {
+        for (const char *doc : docs) {
+            std::string jdata = fill.substr(0, shift % fill.size()) + doc;
+            UniValue scanned, indexed;
+            bool scanResult = scanned.read(jdata);
+            f_assert(indexed.read(jdata, UniValue::READ_INDEXED) == scanResult);
+            f_assert(indexed.write() == scanned.write());
+        }
+    }
+}
+
+// Counts events and sums numbers, optionally giving up after a number of events
+struct CountingHandler
+{
+    size_t events{0};
+    size_t abortAt{SIZE_MAX};
+    size_t objects{0}, arrays{0}, keys{0}, strings{0}, nulls{0}, bools{0};
+    double sum{0};
+    std::string trace;
+
+    bool event(char c) { trace += c; return ++events < abortAt; }
+    bool on_null() { nulls++; return event('n'); }
+    bool on_bool(bool val) { bools++; return event(val ? 't' : 'f'); }
+    bool on_number(std::string_view val) { sum += strtod(std::string(val).c_str(), nullptr); return event('#'); }
+    bool on_string(std::string_view) { strings++; return event('s'); }
+    bool on_key(std::string_view) { keys++; return event('k'); }
+    bool on_object_begin() { objects++; return event('{'); }
+    bool on_object_end() { return event('}'); }
+    bool on_array_begin() { arrays++; return event('['); }
+    bool on_array_end() { return event(']'); }
+};
+
+void sax_test()
+{
+    const std::string doc = "{\"a\":[1,2.5,-3e1],\"b\":{\"c\":\"d\",\"e\":null},\"f\":[true,false,[]]}";
+    CountingHandler handler;
+    f_assert(readSax(handler, doc.data(), doc.size()));
+    f_assert(handler.trace == "{k[###]k{kskn}k[tf[]]}");
+    f_assert(handler.objects == 2);
+    f_assert(handler.arrays == 3);
+    f_assert(handler.keys == 5);
+    f_assert(handler.strings == 1);
+    f_assert(handler.nulls == 1);
+    f_assert(handler.bools == 2);
+    f_assert(handler.sum == -26.5);
+
+    // Scalars on their own
+    CountingHandler scalar;
+    f_assert(readSax(scalar, " \"x\" ", 5));
+    f_assert(scalar.trace == "s");
+
+    // Events are reported up to the first error
+    CountingHandler invalid;
+    f_assert(!readSax(invalid, "[1,{]", 5));
+    f_assert(invalid.trace == "[#{");
+
+    // A handler returning false stops the parse
+    for (size_t abortAt = 1; abortAt < handler.events; abortAt++) {
+        CountingHandler aborting;
+        aborting.abortAt = abortAt;
+        f_assert(!readSax(aborting, doc.data(), doc.size()));
+        f_assert(aborting.events == abortAt);
+    }
+
+    // Repeated keys reach the handler as they are. The readers that build
+    // values reject a container that can't be merged into the first one.
+    const std::string repeated = "{\"\":null,\"\":{\"xxxxxxxxxxxxxxxx\":true}}";
+    CountingHandler members;
+    f_assert(readSax(members, repeated.data(), repeated.size()));
+    f_assert(members.trace == "{knk{kt}}");
+    UniValue val;
+    f_assert(!val.read(repeated));
+    VariParser parser;
+    f_assert(!parser.read(val, repeated));
+    VariDocument vdoc;
+    f_assert(!vdoc.read(repeated));
+    VariTape tape;
+    f_assert(!tape.read(repeated));
+    std::vector<UniValue> values;
+    std::vector<NdjsonError> errors;
+    f_assert(!readNdjson(values, errors, repeated.data(), repeated.size()));
+    f_assert(errors.size() == 1);
+}
+
+void view_test()
+{
+    std::string doc = "{\"a\": {\"b\": [10, \"x\\u00e9\", true, null]}, \"c\\n\": -1.5, \"list\": [";
+    for (int i = 0; i < 1000; i++)
+        doc += (i ? ",{\"n\":" : "{\"n\":") + std::to_string(i) + ",\"s\":\"]}\\\"\"}";
+    doc += "], \"a\": 2}";
+
+    UniValue expected;
+    f_assert(expected.read(doc));
+    VariViewDoc vdoc(doc);
+    const VariView root = vdoc.root();
+    f_assert(viewMatches(root, expected));
+
+    f_assert(root.isObject());
+    f_assert(root["a"]["b"][0].get_int64() == 10);
+    f_assert(root["a"]["b"][1].get_str() == "x\xc3\xa9");
+    f_assert(root["a"]["b"][2].isTrue());
+    f_assert(root["a"]["b"][3].isNull());
+    f_assert(root["a"]["b"][4].isNull());
+    f_assert(root["c\n"].get_real() == -1.5);
+    f_assert(find_value(root, "c\n").getValStr() == "-1.5");
+    f_assert(!root.exists("missing"));
+    f_assert(root["missing"].isNull());
+    f_assert(root["a"]["b"]["nope"].isNull());
+    f_assert(root.getKeys() == std::vector<std::string>({"a", "c\n", "list", "a"}));
+    f_assert(root["a"].raw() == "{\"b\": [10, \"x\\u00e9\", true, null]}");
+
+    // Lookups in any order, with and without the offset cache
+    const VariView list = root["list"];
+    for (size_t i : {999, 0, 500, 31, 32, 33, 998, 64, 1, 1000}) {
+        if (i < 1000) {
+            f_assert(list[i]["n"].get_int() == (int)i);
+            f_assert(list[i]["s"].get_str() == "]}\"");
+        } else {
+            f_assert(list[i].isNull());
+        }
+    }
+    f_assert(list.size() == 1000);
+
+    bool threw = false;
+    try { root["a"].get_str(); } catch (const std::runtime_error&) { threw = true; }
+    f_assert(threw);
+
+    // Malformed input is found when it is reached
+    VariViewDoc bad("{\"a\": 1, \"b\": [1, 2, tru], \"c\": \"unterminated}");
+    f_assert(bad.root()["a"].get_int() == 1);
+    f_assert(bad.root()["b"][0].get_int() == 1);
+    threw = false;
+    try { bad.root()["b"][2].get_bool(); } catch (const std::runtime_error&) { threw = true; }
+    f_assert(threw);
+    threw = false;
+    try { bad.root()["c"].get_str(); } catch (const std::runtime_error&) { threw = true; }
+    f_assert(threw);
+    threw = false;
+    try { bad.root()["d"]; } catch (const std::runtime_error&) { threw = true; }
+    f_assert(threw);
+}
+
+void tape_test()
+{
+    const std::string doc = "{\"a\":[1,\"two\",{\"x\":null}],\"b\":{\"c\":true,\"d\":-2.5e1},\"b\":1,\"e\":\"\\u00e9\"}";
+    VariTape tape;
+    f_assert(tape.read(doc));
+    // Two entries per string, key or number, one for everything else, and
+    // one buffer for all text
+    f_assert(tape.tape().size() == 34);
+    f_assert(tape.strings() == "a1twoxbcd-2.5e1b1e\xc3\xa9");
+
+    const VariTape::Cursor root = tape.root();
+    f_assert(root.isObject());
+    f_assert(root.size() == 4);
+    f_assert(root["a"].size() == 3);
+    f_assert(root["a"][0].get_int64() == 1);
+    f_assert(root["a"][1].get_str() == "two");
+    f_assert(root["a"][2]["x"].isNull());
+    f_assert(root["a"][2].exists("x"));
+    f_assert(!root["a"][3]);
+    f_assert(root["b"]["c"].isTrue());
+    f_assert(root["b"]["d"].get_real() == -25);
+    f_assert(root["e"].get_str() == "\xc3\xa9");
+    f_assert(!root["missing"]);
+    f_assert(root["missing"].isNull());
+
+    std::string keys;
+    for (VariTape::Cursor member = root.child(); member; member = member.next())
+        keys += member.key();
+    f_assert(keys == "abbe");
+
+    // Duplicate keys resolve like read()
+    UniValue val;
+    f_assert(val.read(doc));
+    f_assert(tape.toValue().write() == val.write());
+    f_assert(root["b"].value().write() == val["b"].write());
+
+    // Repeated keys that read() can't merge are rejected, in small objects
+    // and in ones past the pairwise check
+    std::string members;
+    for (int i = 0; i < 40; i++)
+        members += "\"k" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    for (const std::string& prefix : {std::string(), members}) {
+        for (const char *rest : {"\"a\":1,\"a\":[]}", "\"a\":[1],\"a\":{}}", "\"o\":{\"b\":1},\"x\":0,\"o\":{\"b\":[]}}",
+                                 "\"a\":[],\"a\":1}", "\"a\":[1],\"a\":[2]}", "\"o\":{\"b\":1},\"o\":{\"c\":[]}}"}) {
+            const std::string json = "[{" + prefix + rest + "]";
+            f_assert(tape.read(json) == val.read(json));
+            if (val.read(json))
+                f_assert(tape.toValue().write() == val.write());
+        }
+    }
+
+    bool threw = false;
+    try { root["a"].get_str(); } catch (const std::runtime_error&) { threw = true; }
+    f_assert(threw);
+
+    // Numbers convert like a VariValue holding the same text, out of range
+    // ones included
+    const std::string nums = "[0,-0,7,-2147483648,2147483648,9223372036854775807,9223372036854775808,"
+                             "18446744073709551616,1.0,-1.5e3,1e400,1e-400,4.9e-324]";
+    VariTape numTape;
+    f_assert(numTape.read(nums) && val.read(nums));
+    // The result as text, or the error message
+    auto convert = [](const auto& num, int kind) -> std::string {
+        try {
+            if (kind == 0) return std::to_string(num.get_int());
+            if (kind == 1) return std::to_string(num.get_int64());
+            return std::to_string(num.get_real());
+        } catch (const std::runtime_error& e) {
+            return e.what();
+        }
+    };
+    for (size_t i = 0; i < val.size(); i++) {
+        for (int kind = 0; kind < 3; kind++)
+            f_assert(convert(numTape.root()[i], kind) == convert(val[i], kind));
+    }
+
+    // Counts past what fits in an entry are found by walking
+    std::string big = "[";
+    for (size_t i = 0; i <= VariTape::COUNT_MAX; i++)
+        big += i ? ",0" : "0";
+    big += "]";
+    f_assert(tape.read(big));
+    f_assert(tape.root().size() == VariTape::COUNT_MAX + 1);
+
+    f_assert(!tape.read("[1,]"));
+    f_assert(!tape.root());
+}
+
+void ndjson_test()
+{
+    // Enough lines to be split into several chunks, with bad and blank
+    // lines sprinkled in
+    std::string input;
+    std::vector<std::string> lines;
+    for (int i = 0; i < 20000; i++) {
+        std::string line;
+        if (i % 997 == 3)
+            line = "{\"broken\": [" + std::to_string(i);
+        else if (i % 1000 == 7)
+            line = i % 2 ? "" : " \t\r";
+        else
+            line = "{\"n\":" + std::to_string(i) + ",\"s\":\"line " + std::to_string(i) + "\",\"a\":[true,null]}";
+        lines.push_back(line);
+        input += line + (i % 3 ? "\n" : "\r\n");
+    }
+    input.pop_back(); // no newline after the last record
+
+    std::vector<UniValue> expected;
+    std::vector<size_t> expectedBad;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (rtrim(lines[i]).empty())
+            continue;
+        UniValue val;
+        if (!val.read(lines[i])) {
+            val.clear();
+            expectedBad.push_back(i + 1);
+        }
+        expected.push_back(val);
+    }
+
+    for (unsigned int threads : {1, 2, 4, 7, 0}) {
+        std::vector<UniValue> values;
+        std::vector<NdjsonError> errors;
+        f_assert(!readNdjson(values, errors, input.data(), input.size(), threads));
+        f_assert(values.size() == expected.size());
+        for (size_t i = 0; i < values.size() && i < expected.size(); i++)
+            f_assert(values[i].write() == expected[i].write());
+        f_assert(errors.size() == expectedBad.size());
+        for (size_t i = 0; i < errors.size() && i < expectedBad.size(); i++) {
+            f_assert(errors[i].line == expectedBad[i]);
+            f_assert(input.compare(errors[i].offset, 11, "{\"broken\": ") == 0);
+            f_assert(values[errors[i].record].isNull());
+        }
+    }
+
+    std::vector<UniValue> values;
+    std::vector<NdjsonError> errors;
+    f_assert(readNdjson(values, errors, "1\n\n[2]\n", 7, 2));
+    f_assert(values.size() == 2 && errors.empty());
+    f_assert(readNdjson(values, errors, "", 0));
+    f_assert(values.empty());
+}
+
+void parallel_read_test()
+{
+    // Elements full of commas and brackets at other depths and in strings
+    std::string doc = " [";
+    for (int i = 0; doc.size() < 6 * UniValue::PARALLEL_MIN_SLICE; i++) {
+        doc += i ? "," : "";
+        switch (i % 4) {
+        case 0: doc += "{\"a\":[1,2,{\"b\":\"x,]\\\",y\"}],\"c\":" + std::to_string(i) + "}"; break;
+        case 1: doc += "[[],[\",\"],{}]"; break;
+        case 2: doc += "\"" + std::string(i % 50, ',') + "\\\\\""; break;
+        case 3: doc += std::to_string(i * 1.5); break;
+        }
+    }
+    doc += "]\n";
+
+    UniValue expected;
+    f_assert(expected.read(doc));
+    for (unsigned int threads : {0, 1, 2, 3, 8}) {
+        UniValue val;
+        f_assert(val.readParallel(doc.data(), doc.size(), threads));
+        f_assert(val.write() == expected.write());
+    }
+    UniValue val;
+    f_assert(val.read(doc, UniValue::READ_PARALLEL));
+    f_assert(val.write() == expected.write());
+
+    // Damage anywhere must give the same outcome as the serial reader
+    const std::string damage[] = {",", "]", "[", "\"", "}", " x", ",]"};
+    for (size_t pos = 2; pos < doc.size(); pos += doc.size() / 13) {
+        for (const std::string& d : damage) {
+            std::string bad = doc;
+            bad.insert(pos, d);
+            UniValue serial, parallel;
+            bool serialResult = serial.read(bad);
+            f_assert(parallel.readParallel(bad.data(), bad.size(), 4) == serialResult);
+            f_assert(parallel.write() == serial.write());
+        }
+    }
+    for (const char *tail : {",]", "] x", "", ",,1]"}) {
+        std::string bad = doc.substr(0, doc.size() - 2) + tail;
+        UniValue serial, parallel;
+        bool serialResult = serial.read(bad);
+        f_assert(parallel.readParallel(bad.data(), bad.size(), 4) == serialResult);
+        f_assert(parallel.write() == serial.write());
+    }
+}
+
+void document_test()
+{
+    UniValue copy;
+    std::string expected;
+    {
+        VariDocument doc;
+        f_assert(doc.read("{\"a\":[1,2,{\"b\":\"a string too long for small string optimization\"}],\"c\":{}}"));
+        expected = doc.root().write();
+
+        // Documents can be read into again, and modified in place
+        f_assert(doc.read("[]"));
+        f_assert(doc.root().push_back(UniValue(UniValue::VOBJ)));
+        f_assert(doc.root().write() == "[{}]");
+        f_assert(!doc.read("[1,"));
+
+        f_assert(doc.read(expected));
+        f_assert(doc.root().push_back(3) == false);
+        // Nothing in the arena is shared, since a copy may outlive it
+        doc.root().share();
+        const UniValue& root = doc.root();
+        UniValue deep(root);
+        f_assert(&deep["a"][2] != &root["a"][2]);
+        copy = doc.root();
+        doc.clear();
+        f_assert(doc.root().isNull());
+    }
+    // Copies don't depend on the document
+    f_assert(copy.write() == expected);
+    f_assert(copy["a"][2]["b"].get_str() == "a string too long for small string optimization");
+}
+
+void parser_reuse_test()
+{
+    const std::string docs[] = {
+        "{\"a\":[1,2,{\"b\":\"a string too long for small string optimization\"}],\"c\":{}}",
+        "[1,",
+        "[\"esc\\u00e9aped\",true,null,-1.5e3]",
+        "{\"a\":",
+        "{\"k\":{\"k\":[[],{}]},\"k\":{\"j\":1}}",
+    };
+    std::vector<std::string> expected;
+    std::vector<bool> expectedOk;
+    for (const std::string& doc : docs) {
+        UniValue val;
+        expectedOk.push_back(val.read(doc));
+        expected.push_back(val.write());
+    }
+
+    for (VariParser::NodeAlloc nodes : {VariParser::NODES_HEAP, VariParser::NODES_POOLED}) {
+        VariParser parser(nodes);
+        UniValue val;
+        // Failed reads in between mustn't leave anything behind
+        for (int round = 0; round < 3; round++) {
+            for (size_t i = 0; i < ARRAY_SIZE(docs); i++) {
+                for (UniValue::ReadMode mode : {UniValue::READ_SEQUENTIAL, UniValue::READ_INDEXED}) {
+                    f_assert(parser.read(val, docs[i], mode) == expectedOk[i]);
+                    if (expectedOk[i])
+                        f_assert(val.write() == expected[i]);
+                }
+            }
+        }
+
+        // Reading drops a document being fed
+        f_assert(parser.feed("[1,"));
+        f_assert(parser.read(val, docs[0]));
+        f_assert(val.write() == expected[0]);
+        f_assert(parser.feed("[2]") && parser.finish());
+        f_assert(parser.value().write() == "[2]");
+    }
+}
+
+void intern_test()
+{
+    const std::string json = "[{\"txid\":\"aa\",\"scriptPubKey\":{\"a much longer key than inline\":1}},"
+                             "{\"txid\":\"bb\",\"scriptPubKey\":{\"a much longer key than inline\":2}},"
+                             "{\"txid\":{\"x\":1},\"txid\":{\"y\":2}}]";
+    UniValue plain;
+    f_assert(plain.read(json));
+
+    VariSymbols symbols;
+    UniValue val;
+    for (UniValue::ReadMode mode : {UniValue::READ_SEQUENTIAL, UniValue::READ_INDEXED, UniValue::READ_PARALLEL}) {
+        f_assert(val.read(json, symbols, mode));
+        f_assert(val.write() == plain.write());
+    }
+    f_assert(symbols.size() == 5);
+
+    // Repeated keys share one copy, and look up by pointer
+    const VariKey& first = *val[0].keys().begin();
+    const VariKey& second = *val[1].keys().begin();
+    f_assert(first.interned() && !plain[0].keys().begin()->interned());
+    f_assert(first.view().data() == second.view().data());
+    f_assert(val[0]["scriptPubKey"].keys().begin()->view().data() ==
+             val[1]["scriptPubKey"].keys().begin()->view().data());
+    const VariKey txid = symbols.intern("txid");
+    f_assert(txid == first && txid.view().data() == first.view().data());
+    f_assert(val[1][txid].get_str() == "bb");
+    f_assert(find_value(val[2], txid).write() == "{\"x\":1,\"y\":2}");
+    f_assert(val[0][symbols.intern("vout")].isNull());
+
+    // Keys from elsewhere are compared by text
+    VariSymbols other;
+    f_assert(val[0][other.intern("txid")].get_str() == "aa");
+    f_assert(plain[0][txid].get_str() == "aa");
+    f_assert(val[0][VariKey("txid")].get_str() == "aa");
+    symbols.clear();
+    f_assert(val[1][symbols.intern("txid")].get_str() == "bb");
+
+    // Keys outlive their table, in copies too
+    UniValue copy;
+    {
+        VariSymbols scoped;
+        UniValue tmp;
+        f_assert(tmp.read(json, scoped));
+        copy = tmp[0];
+    }
+    f_assert(copy.write() == plain[0].write());
+
+    // Documents and parsers intern when given a table, including objects
+    // big enough to be indexed
+    std::string big = "{";
+    for (int i = 0; i < 100; i++)
+        big += (i ? ",\"key" : "\"key") + std::to_string(i) + "\":" + std::to_string(i);
+    big += "}";
+    VariDocument doc;
+    doc.internKeys(&other);
+    f_assert(doc.read(big));
+    f_assert(doc.root()[other.intern("key42")].get_int() == 42);
+    f_assert(doc.root().keys().begin()->interned());
+    VariParser parser;
+    parser.internKeys(&other);
+    f_assert(parser.feed(big.substr(0, 100)) && parser.feed(big.substr(100)) && parser.finish());
+    f_assert(parser.value()[other.intern("key99")].get_int() == 99);
+    f_assert(parser.value().keys().begin()->view().data() == doc.root().keys().begin()->view().data());
+    parser.internKeys(nullptr);
+    f_assert(parser.read(val, big));
+    f_assert(!val.keys().begin()->interned() && val["key7"].get_int() == 7);
+}
+
 int main (int argc, char *argv[])
 {
     for (unsigned int fidx = 0; fidx < ARRAY_SIZE(filenames); fidx++) {
@@ -165,6 +866,18 @@ int main (int argc, char *argv[])
     }
 
     unescape_unicode_test();
+    long_string_test();
+    push_parser_test();
+    push_parser_long_string_test();
+    indexed_read_test();
+    sax_test();
+    view_test();
+    tape_test();
+    ndjson_test();
+    parallel_read_test();
+    document_test();
+    parser_reuse_test();
+    intern_test();
 
     return test_failed ? 1 : 0;
 }
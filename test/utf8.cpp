@@ -0,0 +1,165 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Differential test of the vectorized UTF-8 validation against the
+// byte-at-a-time JSONUTF8StringFilter.
+
+#include <stdio.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "varivalue_util.h"
+#include "varivalue_utf8.h"
+#include "univalue_utffilter.h"
+
+static bool test_failed = false;
+
+#define f_assert(expr) { if (!(expr)) { test_failed = true; fprintf(stderr, "%s failed: %s\n", __func__, #expr); } }
+
+// A string body: raw bytes, or \u escapes when codepoint is set
+struct Piece
+{
+    unsigned char ch;
+    unsigned int codepoint;
+    bool escaped;
+};
+
+// Decode with the plain filter, one byte or escape at a time
+static bool reference(const std::vector<Piece>& pieces, std::string& out)
+{
+    out.clear();
+    JSONUTF8StringFilter writer(out);
+    for (const Piece& p : pieces) {
+        if (p.escaped)
+            writer.push_back_u(p.codepoint);
+        else
+            writer.push_back(p.ch);
+    }
+    return writer.finalize();
+}
+
+static std::string toJson(const std::vector<Piece>& pieces)
+{
+    std::string json = "\"";
+    for (const Piece& p : pieces) {
+        if (p.escaped) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", p.codepoint);
+            json += buf;
+        } else {
+            json += p.ch;
+        }
+    }
+    return json + "\"";
+}
+
+static void check(const std::vector<Piece>& pieces)
+{
+    std::string expected;
+    bool expectedValid = reference(pieces, expected);
+
+    std::string json = toJson(pieces);
+    std::string_view tokenVal;
+    std::string scratch;
+    unsigned int consumed;
+    jtokentype tok = getJsonToken(tokenVal, scratch, consumed, json.data(), json.data() + json.size());
+    f_assert((tok == JTOK_STRING) == expectedValid);
+    if (tok == JTOK_STRING && expectedValid) {
+        f_assert(tokenVal == expected);
+        f_assert(consumed == json.size());
+    }
+
+    bool hasEscapes = false;
+    std::string bytes;
+    for (const Piece& p : pieces) {
+        hasEscapes |= p.escaped;
+        bytes += p.ch;
+    }
+    if (hasEscapes)
+        return;
+
+    bool scalar = validUtf8(bytes.data(), bytes.size(), UTF8_SCALAR);
+    for (Utf8Impl impl : {UTF8_AUTO, UTF8_SSSE3, UTF8_AVX2}) {
+        if (utf8ImplSupported(impl))
+            f_assert(validUtf8(bytes.data(), bytes.size(), impl) == scalar);
+    }
+    // Whatever the validator accepts, the filter must pass through unchanged
+    if (scalar) {
+        f_assert(expectedValid);
+        f_assert(expected == bytes);
+    }
+}
+
+static std::vector<Piece> fromBytes(const std::string& bytes)
+{
+    std::vector<Piece> pieces;
+    for (unsigned char ch : bytes)
+        pieces.push_back({ch, 0, false});
+    return pieces;
+}
+
+// Every lead byte followed by continuation candidates around the range
+// boundaries, truncated at every length, at every offset in a vector block
+void utf8_boundary_test()
+{
+    const unsigned char follow[] = {0x00, 0x41, 0x7f, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf, 0xc0, 0xff};
+    for (unsigned int lead = 0x80; lead <= 0xff; lead++) {
+        for (unsigned char b1 : follow) {
+            for (unsigned char b2 : {0x41, 0x80, 0xbf, 0xc0}) {
+                for (unsigned char b3 : {0x41, 0x80, 0xbf}) {
+                    std::string seq{char(lead), char(b1), char(b2), char(b3)};
+                    for (size_t len = 1; len <= seq.size(); len++) {
+                        for (size_t pad : {0, 1, 13, 14, 15, 29, 30, 31, 47}) {
+                            std::string bytes = std::string(pad, 'a') + seq.substr(0, len) + "bc";
+                            // Keep the string body free of control characters
+                            if (bytes.find('\0') != std::string::npos)
+                                continue;
+                            check(fromBytes(bytes));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Random mixes of ASCII, well-formed and broken UTF-8 and \u escapes
+void utf8_random_test()
+{
+    std::mt19937 rng(42);
+    const std::string valid[] = {"a", "\xc3\xa9", "\xe4\xb8\xad", "\xf0\x9f\x98\x80", "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf"};
+    const std::string lax[] = {"\xc0\x80", "\xe0\x80\x80", "\xed\xa0\xbd", "\xed\xb8\x80", "\xf4\x90\x80\x80", "\xf7\xbf\xbf\xbf"};
+    const std::string broken[] = {"\x80", "\xc3", "\xe4\xb8", "\xf8\x88\x80\x80\x80", "\xff"};
+    const unsigned int escapes[] = {0x41, 0xe9, 0x4e2d, 0xd83d, 0xde00, 0xdbff, 0xdfff};
+
+    for (int iter = 0; iter < 20000; iter++) {
+        std::vector<Piece> pieces;
+        size_t n = rng() % 80;
+        for (size_t i = 0; i < n; i++) {
+            unsigned int pick = rng() % 100;
+            std::string add;
+            if (pick < 60)
+                add = valid[rng() % 6];
+            else if (pick < 70)
+                add = lax[rng() % 6];
+            else if (pick < 75)
+                add = broken[rng() % 5];
+            else if (pick < 85)
+                add = std::string(1, char(0x80 + rng() % 0x80));
+            else
+                pieces.push_back({0, escapes[rng() % 7], true});
+            for (unsigned char ch : add)
+                pieces.push_back({ch, 0, false});
+        }
+        check(pieces);
+    }
+}
+
+int main (int argc, char *argv[])
+{
+    utf8_boundary_test();
+    utf8_random_test();
+
+    return test_failed ? 1 : 0;
+}
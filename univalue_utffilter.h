@@ -45,6 +45,27 @@ public:
                 push_back_u(codepoint);
         }
     }
+    // Write a run of 7-bit ASCII characters, same as push_back on each
+    void append_ascii(const char *first, const char *last)
+    {
+        if (first == last)
+            return;
+        if (state) // Not a continuation, invalid
+            is_valid = false;
+        else
+            str.append(first, last);
+    }
+    // Write a run of well-formed UTF-8 as checked by validUtf8() that starts
+    // with a multi-byte character, same as push_back on each byte
+    void append_utf8(const char *first, const char *last)
+    {
+        if (first == last)
+            return;
+        if (state || surpair) // The run can't continue an open sequence or pair
+            is_valid = false;
+        else
+            str.append(first, last);
+    }
     // Write codepoint directly, possibly collating surrogate pairs
     void push_back_u(unsigned int codepoint_)
     {
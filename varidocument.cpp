@@ -0,0 +1,37 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "varidocument.h"
+#include "variparser.h"
+#include "varivalue_sax.h"
+
+#include <algorithm>
+
+namespace {
+
+// Parsed trees typically take a few times the size of their input
+static constexpr size_t ARENA_GROWTH = 4;
+static constexpr size_t ARENA_MIN = 4096;
+
+} // namespace
+
+bool VariDocument::read(const char *raw, size_t len)
+{
+    clear();
+    const size_t want = std::max(ARENA_MIN, len * ARENA_GROWTH);
+    if (m_bufferSize < want) {
+        m_buffer.reset(new std::byte[want]);
+        m_bufferSize = want;
+    }
+    m_arena.emplace(m_buffer.get(), m_bufferSize);
+    VariValueBuilder builder(m_root, &*m_arena);
+    builder.setSymbols(m_symbols);
+    return readSax(builder, raw, len);
+}
+
+void VariDocument::clear()
+{
+    m_root.clear();
+    m_arena.reset();
+}
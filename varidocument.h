@@ -0,0 +1,59 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIDOCUMENT_H__
+#define __VARIDOCUMENT_H__
+
+#include "varivalue.h"
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <memory>
+#include <string>
+
+/**
+ * A VariValue tree whose objects and arrays live in a per-document
+ * monotonic arena. Reading costs a handful of large allocations instead of
+ * one per node, and clearing or destroying the document hands the memory
+ * back in one go. Strings keep their own storage, so that get_str() and
+ * friends are unchanged; short ones don't allocate anyway.
+ *
+ * Copies of values taken from the document use the default heap and may
+ * outlive it. Values moved out of it still point into the arena, so they
+ * must not.
+ */
+class VariDocument
+{
+public:
+    VariDocument() = default;
+    VariDocument(const VariDocument&) = delete;
+    VariDocument& operator=(const VariDocument&) = delete;
+
+    // Accepts exactly what VariValue::read() accepts
+    bool read(const char *raw, size_t len);
+    bool read(const std::string& rawStr) { return read(rawStr.data(), rawStr.size()); }
+
+    // Intern object keys into symbols on later reads, or copy them if null.
+    // One table may serve many documents, so long as they are read on one
+    // thread.
+    void internKeys(VariSymbols *symbols) { m_symbols = symbols; }
+
+    VariValue& root() { return m_root; }
+    const VariValue& root() const { return m_root; }
+
+    // Drop the tree and release the arena. Its first block is kept for the
+    // next read() to reuse.
+    void clear();
+
+private:
+    // Declared first, so that the tree is destroyed before its memory
+    std::unique_ptr<std::byte[]> m_buffer;
+    size_t m_bufferSize{0};
+    std::optional<std::pmr::monotonic_buffer_resource> m_arena;
+    VariSymbols *m_symbols{nullptr};
+    VariValue m_root;
+};
+
+#endif // __VARIDOCUMENT_H__
@@ -1,67 +1,316 @@
 #include "varinum.h"
+#include "varivalue.h"
 #include "varivalue_util.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
 #include <cstring>
-#include <iomanip>
+#include <iterator>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
 
 namespace
 {
-static bool ParsePrechecks(const std::string& str)
+// strtol and stream extraction took a leading '+', from_chars doesn't
+std::string_view SkipPlus(std::string_view str)
 {
-    if (str.empty()) // No empty string allowed
-        return false;
-    if (str.size() >= 1 && (json_isspace(str[0]) || json_isspace(str[str.size()-1]))) // No padding allowed
-        return false;
-    if (str.size() != strlen(str.c_str())) // No embedded NUL characters allowed
+    if (str.size() >= 2 && str[0] == '+' && str[1] != '-')
+        str.remove_prefix(1);
+    return str;
+}
+
+// Unlike strtol, from_chars takes no locale and needs no NUL terminator.
+// It doesn't skip padding either, and reports overflow of the target type
+// itself.
+template <typename T>
+bool ParseInt(std::string_view str, T *out)
+{
+    str = SkipPlus(str);
+    const char *end = str.data() + str.size();
+    T n;
+    auto [ptr, ec] = std::from_chars(str.data(), end, n);
+    if (ec != std::errc() || ptr != end)
         return false;
+    if(out) *out = n;
     return true;
 }
 
-bool ParseInt32(const std::string& str, int32_t *out)
+bool ParseInt32(std::string_view str, int32_t *out)
 {
-    if (!ParsePrechecks(str))
-        return false;
-    char *endp = NULL;
-    errno = 0; // strtol will not set errno if valid
-    long int n = strtol(str.c_str(), &endp, 10);
-    if(out) *out = (int32_t)n;
-    // Note that strtol returns a *long int*, so even if strtol doesn't report an over/underflow
-    // we still have to check that the returned value is within the range of an *int32_t*. On 64-bit
-    // platforms the size of these types may be different.
-    return endp && *endp == 0 && !errno &&
-        n >= std::numeric_limits<int32_t>::min() &&
-        n <= std::numeric_limits<int32_t>::max();
+    return ParseInt(str, out);
 }
 
-bool ParseInt64(const std::string& str, int64_t *out)
+bool ParseInt64(std::string_view str, int64_t *out)
 {
-    if (!ParsePrechecks(str))
-        return false;
-    char *endp = NULL;
-    errno = 0; // strtoll will not set errno if valid
-    long long int n = strtoll(str.c_str(), &endp, 10);
-    if(out) *out = (int64_t)n;
-    // Note that strtoll returns a *long long int*, so even if strtol doesn't report a over/underflow
-    // we still have to check that the returned value is within the range of an *int64_t*.
-    return endp && *endp == 0 && !errno &&
-        n >= std::numeric_limits<int64_t>::min() &&
-        n <= std::numeric_limits<int64_t>::max();
+    return ParseInt(str, out);
 }
 
-bool ParseDouble(const std::string& str, double *out)
+bool ParseDoubleStream(std::string_view str, double *out)
 {
-    if (!ParsePrechecks(str))
-        return false;
-    if (str.size() >= 2 && str[0] == '0' && str[1] == 'x') // No hexadecimal floats allowed
-        return false;
-    std::istringstream text(str);
+    std::istringstream text{std::string(str)};
     text.imbue(std::locale::classic());
     double result;
     text >> result;
     if(out) *out = result;
     return text.eof() && !text.fail();
 }
+
+// from_chars is correctly rounded and doesn't take the locale lock that
+// stream extraction does. Hexadecimal floats are rejected since the 0x
+// prefix isn't part of the general format.
+bool ParseDouble(std::string_view str, double *out)
+{
+    str = SkipPlus(str);
+    const char *end = str.data() + str.size();
+    double result;
+    auto [ptr, ec] = std::from_chars(str.data(), end, result);
+    if (ptr != end)
+        return false;
+    // from_chars also rejects values too small to represent, which stream
+    // extraction rounds to zero instead
+    if (ec == std::errc::result_out_of_range)
+        return ParseDoubleStream(str, out);
+    // Nor does stream extraction know about "inf" and "nan"
+    if (ec != std::errc() || !std::isfinite(result))
+        return false;
+    if(out) *out = result;
+    return true;
+}
+
+constexpr uint64_t POW10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+uint64_t LoadWord(const char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+// Whether all 8 bytes of v are ASCII digits
+bool EightDigitsValid(uint64_t v)
+{
+    return ((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+           0x3333333333333333ULL;
+}
+
+// Value of the 8 ASCII digits at p, converted in parallel within one word
+uint64_t EightDigits(const char *p)
+{
+    uint64_t v = LoadWord(p) - 0x3030303030303030ULL;
+    v = v * 10 + (v >> 8);
+    return (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+}
+
+// acc = acc * 10^n + the n digits at p, failing on overflow
+inline bool AccumulateDigits(uint64_t& acc, const char *p, size_t n)
+{
+    for (; n >= 8; p += 8, n -= 8) {
+        if (__builtin_mul_overflow(acc, POW10[8], &acc) || __builtin_add_overflow(acc, EightDigits(p), &acc))
+            return false;
+    }
+    for (; n > 0; p++, n--) {
+        if (__builtin_mul_overflow(acc, 10, &acc) || __builtin_add_overflow(acc, uint64_t(*p - '0'), &acc))
+            return false;
+    }
+    return true;
+}
+
+inline size_t DigitRun(std::string_view str, size_t pos)
+{
+    const size_t start = pos;
+    while (pos + 8 <= str.size() && EightDigitsValid(LoadWord(str.data() + pos)))
+        pos += 8;
+    while (pos < str.size() && str[pos] >= '0' && str[pos] <= '9')
+        pos++;
+    return pos - start;
+}
+
+// Parse a JSON number into its value times 10^decimals, exactly. Fails if
+// that isn't an integer (beyond trailing zeros) or doesn't fit an int64_t.
+bool ParseFixed(std::string_view str, int decimals, int64_t *out)
+{
+    if (decimals < 0 || decimals > VariNum::MAX_DECIMALS)
+        return false;
+
+    size_t pos = 0;
+    const bool neg = !str.empty() && str[0] == '-';
+    pos += neg;
+    const size_t intStart = pos, intLen = DigitRun(str, pos);
+    if (intLen == 0 || (intLen > 1 && str[intStart] == '0'))
+        return false;
+    pos += intLen;
+
+    size_t fracStart = pos, fracLen = 0;
+    if (pos < str.size() && str[pos] == '.') {
+        fracStart = ++pos;
+        fracLen = DigitRun(str, pos);
+        if (fracLen == 0)
+            return false;
+        pos += fracLen;
+    }
+
+    int64_t exponent = 0;
+    if (pos < str.size() && (str[pos] == 'e' || str[pos] == 'E')) {
+        pos++;
+        const bool expNeg = pos < str.size() && str[pos] == '-';
+        if (pos < str.size() && (str[pos] == '-' || str[pos] == '+'))
+            pos++;
+        const size_t expLen = DigitRun(str, pos);
+        if (expLen == 0)
+            return false;
+        // Anything larger is out of range unless the digits are all zero
+        for (size_t i = 0; i < expLen; i++)
+            exponent = std::min<int64_t>(exponent * 10 + (str[pos + i] - '0'), 100000);
+        if (expNeg)
+            exponent = -exponent;
+        pos += expLen;
+    }
+    if (pos != str.size())
+        return false;
+
+    // Trailing zeros of the fraction don't add precision
+    while (fracLen > 0 && str[fracStart + fracLen - 1] == '0')
+        fracLen--;
+    int64_t shift = exponent - int64_t(fracLen) + decimals;
+
+    uint64_t mag = 0;
+    if (!AccumulateDigits(mag, str.data() + intStart, intLen) ||
+        !AccumulateDigits(mag, str.data() + fracStart, fracLen))
+        return false;
+    if (mag == 0) {
+        if(out) *out = 0;
+        return true;
+    }
+    for (; shift < 0; shift++) {
+        if (mag % 10 != 0)
+            return false;
+        mag /= 10;
+    }
+    if (shift >= int64_t(std::size(POW10)) || __builtin_mul_overflow(mag, POW10[shift], &mag))
+        return false;
+
+    const uint64_t limit = uint64_t(std::numeric_limits<int64_t>::max()) + neg;
+    if (mag > limit)
+        return false;
+    if(out) *out = neg ? int64_t(0 - mag) : int64_t(mag);
+    return true;
+}
+}
+
+VariNum::VariNum(const VariNum& other)
+{
+    if (const Payload *payload = other.payload())
+        m_bits = reinterpret_cast<uintptr_t>(new Payload(*payload));
+    else
+        m_bits = other.m_bits;
+}
+
+VariNum::~VariNum()
+{
+    delete payload();
+}
+
+const VariNum::Payload *VariNum::payload() const
+{
+    if ((m_bits & TAG_MASK) != TAG_POINTER || m_bits == 0)
+        return nullptr;
+    return reinterpret_cast<const Payload*>(m_bits);
+}
+
+void VariNum::assign(Payload val)
+{
+    VariNum num;
+    const int64_t *i = std::get_if<int64_t>(&val);
+    const std::string *str = std::get_if<std::string>(&val);
+    if (i && *i >= INLINE_MIN && *i <= INLINE_MAX) {
+        num.m_bits = (static_cast<uint64_t>(*i) << 1) | TAG_INT;
+    } else if (str && str->empty()) {
+        num.m_bits = 0;
+    } else if (uint64_t packed = str ? packText(*str) : 0) {
+        num.m_bits = packed;
+    } else {
+        num.m_bits = reinterpret_cast<uintptr_t>(new Payload(std::move(val)));
+    }
+    *this = std::move(num);
+}
+
+// Number text is packed 4 bits a character, above a 4 bit length and the
+// tag. Returns 0 if str is too long or uses another character.
+uint64_t VariNum::packText(std::string_view str)
+{
+    if (str.empty() || str.size() > INLINE_TEXT_MAX)
+        return 0;
+    uint64_t bits = (str.size() << 2) | TAG_TEXT;
+    for (size_t n = 0; n < str.size(); n++) {
+        const char *pos = static_cast<const char*>(memchr(TEXT_CHARS, str[n], sizeof(TEXT_CHARS)));
+        if (!pos || str[n] == '\0')
+            return 0;
+        bits |= uint64_t(pos - TEXT_CHARS) << (6 + 4 * n);
+    }
+    return bits;
+}
+
+bool VariNum::getText(std::string_view& text, char (&buf)[INLINE_TEXT_MAX]) const
+{
+    if (m_bits == 0) {
+        text = std::string_view();
+        return true;
+    }
+    if ((m_bits & TAG_MASK) == TAG_TEXT) {
+        const size_t len = (m_bits >> 2) & 0xf;
+        for (size_t n = 0; n < len; n++)
+            buf[n] = TEXT_CHARS[(m_bits >> (6 + 4 * n)) & 0xf];
+        text = std::string_view(buf, len);
+        return true;
+    }
+    const Payload *p = payload();
+    const std::string *str = p ? std::get_if<std::string>(p) : nullptr;
+    if (str)
+        text = *str;
+    return str;
+}
+
+bool VariNum::getInt64(int64_t& val) const
+{
+    if (m_bits & TAG_INT) {
+        val = static_cast<int64_t>(m_bits) >> 1;
+        return true;
+    }
+    const Payload *p = payload();
+    const int64_t *i = p ? std::get_if<int64_t>(p) : nullptr;
+    if (i)
+        val = *i;
+    return i;
+}
+
+// Call fn with the stored value as a std::string_view, int64_t, uint64_t or
+// double
+template <typename Fn>
+auto VariNum::visit(Fn&& fn) const
+{
+    if (int64_t val; getInt64(val))
+        return fn(val);
+    if (const Payload *p = payload()) {
+        return std::visit(varivalue::overloaded {
+            [&](const std::string& str) { return fn(std::string_view(str)); },
+            [&](auto val) { return fn(val); },
+        }, *p);
+    }
+    char buf[INLINE_TEXT_MAX];
+    std::string_view text;
+    getText(text, buf);
+    return fn(text);
 }
 
 VariNum::VariNum(uint64_t val)
@@ -84,9 +333,58 @@ VariNum::VariNum(double val)
     setFloat(val);
 }
 
-const std::string& VariNum::getValStr() const
+std::string VariNum::getValStr() const
+{
+    std::string ret;
+    appendValStr(ret);
+    return ret;
+}
+
+void VariNum::appendValStr(std::string& out) const
+{
+    char textBuf[INLINE_TEXT_MAX];
+    if (std::string_view text; getText(text, textBuf)) {
+        out += text;
+        return;
+    }
+    // Shortest text that reads back as the same double, in fixed or
+    // scientific notation, whichever is shorter. Both are valid JSON for
+    // the finite values setFloat() allows, as are integers.
+    char buf[32];
+    const std::to_chars_result res = visit(varivalue::overloaded {
+        [&](std::string_view) { return std::to_chars_result{buf, std::errc()}; },
+        [&](auto val) { return std::to_chars(buf, buf + sizeof(buf), val); },
+    });
+    out.append(buf, res.ptr);
+}
+
+// Store str as an integer if it is one that formats back to exactly str:
+// no leading zeros, no "-0", and within the range of int64_t or uint64_t
+bool VariNum::setCanonicalInt(std::string_view str)
 {
-    return m_value;
+    const bool neg = !str.empty() && str[0] == '-';
+    const std::string_view digits = str.substr(neg);
+    if (digits.empty() || (digits[0] == '0' && (digits.size() > 1 || neg)))
+        return false;
+
+    uint64_t mag = 0;
+    if (DigitRun(digits, 0) != digits.size() || !AccumulateDigits(mag, digits.data(), digits.size()))
+        return false;
+
+    constexpr uint64_t INT64_LIMIT = std::numeric_limits<int64_t>::max();
+    if (!neg) {
+        if (mag <= INT64_LIMIT)
+            assign(static_cast<int64_t>(mag));
+        else
+            assign(mag);
+    } else if (mag <= INT64_LIMIT) {
+        assign(-static_cast<int64_t>(mag));
+    } else if (mag == INT64_LIMIT + 1) {
+        assign(std::numeric_limits<int64_t>::min());
+    } else {
+        return false;
+    }
+    return true;
 }
 
 bool VariNum::setNumStr(std::string val)
@@ -94,26 +392,24 @@ bool VariNum::setNumStr(std::string val)
     if (!validNumStr(val))
         return false;
 
-    m_value = std::move(val);
+    if (!setCanonicalInt(val))
+        assign(std::move(val));
     return true;
 }
 
 bool VariNum::setInt(uint64_t val_)
 {
-    std::ostringstream oss;
-
-    oss << val_;
-
-    return setNumStr(oss.str());
+    if (val_ <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        assign(static_cast<int64_t>(val_));
+    else
+        assign(val_);
+    return true;
 }
 
 bool VariNum::setInt(int64_t val_)
 {
-    std::ostringstream oss;
-
-    oss << val_;
-
-    return setNumStr(oss.str());
+    assign(val_);
+    return true;
 }
 
 bool VariNum::setInt(int val_)
@@ -123,34 +419,101 @@ bool VariNum::setInt(int val_)
 
 bool VariNum::setFloat(double val_)
 {
-    std::ostringstream oss;
+    // Infinities and NaN have no JSON representation
+    if (!std::isfinite(val_))
+        return false;
+
+    assign(val_);
+    return true;
+}
 
-    oss << std::setprecision(16) << val_;
+bool VariNum::setFixed(int64_t val, int decimals)
+{
+    if (decimals < 0 || decimals > MAX_DECIMALS)
+        return false;
+    if (decimals == 0)
+        return setInt(val);
 
-    return setNumStr(oss.str());
+    const uint64_t mag = val < 0 ? 0 - uint64_t(val) : uint64_t(val);
+    const uint64_t whole = mag / POW10[decimals], frac = mag % POW10[decimals];
+    std::string text(val < 0 ? "-" : "");
+    char buf[24];
+    text.append(buf, std::to_chars(buf, buf + sizeof(buf), whole).ptr);
+    text += '.';
+    // The fraction is padded with leading zeros to exactly decimals digits
+    char *end = std::to_chars(buf, buf + sizeof(buf), frac).ptr;
+    text.append(decimals - (end - buf), '0');
+    text.append(buf, end);
+    assign(std::move(text));
+    return true;
 }
 
+int64_t VariNum::get_fixed(int decimals) const
+{
+    int64_t retval, val;
+    char buf[INLINE_TEXT_MAX];
+    std::string_view text;
+    if (getInt64(val)) {
+        if (decimals >= 0 && decimals <= MAX_DECIMALS &&
+            !__builtin_mul_overflow(val, int64_t(POW10[decimals]), &retval))
+            return retval;
+    } else if (getText(text, buf)) {
+        if (ParseFixed(text, decimals, &retval))
+            return retval;
+    } else if (ParseFixed(getValStr(), decimals, &retval)) {
+        return retval;
+    }
+    throw std::runtime_error("JSON amount out of range or too precise");
+}
 
 int VariNum::get_int() const
+{
+    if (int64_t val; getInt64(val)) {
+        if (val < std::numeric_limits<int32_t>::min() || val > std::numeric_limits<int32_t>::max())
+            throw std::runtime_error("JSON integer out of range");
+        return static_cast<int>(val);
+    }
+    return parseInt(getValStr());
+}
+
+int64_t VariNum::get_int64() const
+{
+    int64_t retval;
+    if (getInt64(retval))
+        return retval;
+    return parseInt64(getValStr());
+}
+
+double VariNum::get_real() const
+{
+    return visit(varivalue::overloaded {
+        [](std::string_view str) { return parseReal(str); },
+        [](int64_t val) { return static_cast<double>(val); },
+        [](uint64_t val) { return static_cast<double>(val); },
+        [](double val) { return val; },
+    });
+}
+
+int VariNum::parseInt(std::string_view str)
 {
     int32_t retval;
-    if (!ParseInt32(m_value, &retval))
+    if (!ParseInt32(str, &retval))
         throw std::runtime_error("JSON integer out of range");
     return retval;
 }
 
-int64_t VariNum::get_int64() const
+int64_t VariNum::parseInt64(std::string_view str)
 {
     int64_t retval;
-    if (!ParseInt64(m_value, &retval))
+    if (!ParseInt64(str, &retval))
         throw std::runtime_error("JSON integer out of range");
     return retval;
 }
 
-double VariNum::get_real() const
+double VariNum::parseReal(std::string_view str)
 {
     double retval;
-    if (!ParseDouble(m_value, &retval))
+    if (!ParseDouble(str, &retval))
         throw std::runtime_error("JSON double out of range");
     return retval;
 }
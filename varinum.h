@@ -7,11 +7,21 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
 
 class VariNum
 {
 public:
+    // Most decimals a fixed-point amount can have
+    static constexpr int MAX_DECIMALS = 18;
+
     VariNum() = default;
+    VariNum(const VariNum& other);
+    VariNum(VariNum&& other) noexcept : m_bits(other.m_bits) { other.m_bits = 0; }
+    VariNum& operator=(VariNum other) noexcept { std::swap(m_bits, other.m_bits); return *this; }
+    ~VariNum();
     explicit VariNum(uint64_t val);
     explicit VariNum(int64_t val);
     explicit VariNum(int val);
@@ -22,15 +32,55 @@ public:
     bool setInt(int64_t val);
     bool setInt(int val);
     bool setFloat(double val);
+    bool setFixed(int64_t val, int decimals);
 
     int get_int() const;
     int64_t get_int64() const;
     double get_real() const;
+    int64_t get_fixed(int decimals) const;
+
+    // What get_int(), get_int64() and get_real() return for a VariNum set
+    // to the number text str, without building one
+    static int parseInt(std::string_view str);
+    static int64_t parseInt64(std::string_view str);
+    static double parseReal(std::string_view str);
 
-    const std::string& getValStr() const;
+    // Text is formatted on demand for numbers not stored as text
+    std::string getValStr() const;
+    void appendValStr(std::string& out) const;
     bool setNumStr(std::string val);
 private:
-    std::string m_value;
+    // Integers are stored as such (uint64_t only above the int64_t range),
+    // and doubles set with setFloat() too. Any other number keeps the text
+    // it was given, so that it writes back unchanged.
+    using Payload = std::variant<std::string, int64_t, uint64_t, double>;
+
+    // To keep a VariValue small this is a single word, tagged by its low
+    // bits. Integers in [-2^62, 2^62), the common case, are kept inline
+    // above a set low bit. So is text of up to 14 characters, such as most
+    // decimals, packed 4 bits a character. Anything else is an owning pointer
+    // to a Payload, or 0 for an empty text.
+    uint64_t m_bits{0};
+
+    static constexpr uint64_t TAG_MASK = 3;
+    static constexpr uint64_t TAG_POINTER = 0;
+    static constexpr uint64_t TAG_INT = 1;
+    static constexpr uint64_t TAG_TEXT = 2;
+    static constexpr int64_t INLINE_MIN = -(int64_t{1} << 62);
+    static constexpr int64_t INLINE_MAX = (int64_t{1} << 62) - 1;
+    static constexpr size_t INLINE_TEXT_MAX = 14;
+    static constexpr char TEXT_CHARS[16] = "0123456789.-+eE";
+
+    void assign(Payload val);
+    static uint64_t packText(std::string_view str);
+    const Payload *payload() const;
+    // Text is copied to buf if it is kept inline
+    bool getText(std::string_view& text, char (&buf)[INLINE_TEXT_MAX]) const;
+    bool getInt64(int64_t& val) const;
+    template <typename Fn>
+    auto visit(Fn&& fn) const;
+
+    bool setCanonicalInt(std::string_view str);
 };
 
 #endif // __VARINUM_H__
@@ -0,0 +1,310 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "variobject.h"
+#include "varivalue.h"
+
+#include <cstring>
+#include <random>
+
+namespace {
+
+static constexpr uint64_t HASH_MUL = 0x9e3779b97f4a7c15;
+
+uint64_t Mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    return h;
+}
+
+// Random for each process, so that keys which collide in an object's index
+// can't be prepared in advance to make reading it quadratic. Members are
+// kept in insertion order, so nothing that is output depends on it.
+uint64_t HashSeed()
+{
+    static const uint64_t seed = [] {
+        std::random_device rd;
+        return Mix((uint64_t{rd()} << 32) ^ rd());
+    }();
+    return seed;
+}
+
+// Word-at-a-time hash of a key
+uint64_t HashKey(std::string_view key)
+{
+    uint64_t h = HashSeed() ^ (key.size() * HASH_MUL);
+    const char *p = key.data();
+    size_t len = key.size();
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ word) * HASH_MUL;
+        h ^= h >> 29;
+    }
+    if (len) {
+        uint64_t word = 0;
+        memcpy(&word, p, len);
+        h = (h ^ word) * HASH_MUL;
+    }
+    return Mix(h);
+}
+
+uint64_t KeyHash(std::string_view key)
+{
+    return HashKey(key);
+}
+
+uint64_t KeyHash(const VariKey& key)
+{
+    return key.hash();
+}
+
+std::atomic<uint64_t> g_nextTableId{1};
+
+} // namespace
+
+VariKey::VariKey(std::string_view key)
+{
+    if (key.size() <= INLINE_MAX) {
+        memcpy(m_buf, key.data(), key.size());
+        m_buf[INLINE_MAX] = static_cast<char>(key.size());
+    } else {
+        Symbol *sym = new Symbol{{1}, 0, 0, std::string(key)};
+        memcpy(m_buf, &sym, sizeof(sym));
+        m_buf[INLINE_MAX] = static_cast<char>(SYMBOL);
+    }
+}
+
+VariKey::VariKey(std::string&& key)
+{
+    if (key.size() <= INLINE_MAX) {
+        memcpy(m_buf, key.data(), key.size());
+        m_buf[INLINE_MAX] = static_cast<char>(key.size());
+    } else {
+        Symbol *sym = new Symbol{{1}, 0, 0, std::move(key)};
+        memcpy(m_buf, &sym, sizeof(sym));
+        m_buf[INLINE_MAX] = static_cast<char>(SYMBOL);
+    }
+}
+
+VariKey::VariKey(Symbol *sym)
+{
+    memcpy(m_buf, &sym, sizeof(sym));
+    m_buf[INLINE_MAX] = static_cast<char>(SYMBOL);
+}
+
+VariKey::VariKey(const VariKey& other)
+{
+    memcpy(m_buf, other.m_buf, sizeof(m_buf));
+    if (Symbol *sym = symbol())
+        sym->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+VariKey::VariKey(VariKey&& other) noexcept
+{
+    memcpy(m_buf, other.m_buf, sizeof(m_buf));
+    other.m_buf[INLINE_MAX] = 0;
+}
+
+VariKey& VariKey::operator=(VariKey other) noexcept
+{
+    std::swap(m_buf, other.m_buf);
+    return *this;
+}
+
+VariKey::~VariKey()
+{
+    Symbol *sym = symbol();
+    if (sym && sym->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete sym;
+}
+
+uint64_t VariKey::hashOf(std::string_view key)
+{
+    return HashKey(key);
+}
+
+uint64_t VariKey::hash() const
+{
+    const Symbol *sym = symbol();
+    return sym && sym->table ? sym->hash : HashKey(view());
+}
+
+VariSymbols::VariSymbols() : m_id(g_nextTableId++)
+{
+}
+
+VariKey VariSymbols::intern(std::string_view key)
+{
+    auto it = m_symbols.find(key);
+    if (it == m_symbols.end()) {
+        VariKey sym(new VariKey::Symbol{{1}, m_id, HashKey(key), std::string(key)});
+        it = m_symbols.emplace(sym.view(), std::move(sym)).first;
+    }
+    return it->second;
+}
+
+void VariSymbols::clear()
+{
+    m_symbols.clear();
+    m_id = g_nextTableId++;
+}
+
+VariObject::VariObject() = default;
+
+VariObject::VariObject(std::pmr::memory_resource *resource)
+    : m_items(resource), m_hashes(resource), m_slots(resource)
+{
+}
+
+VariObject::VariObject(const VariObject& other) = default;
+VariObject::VariObject(VariObject&& other) noexcept = default;
+VariObject& VariObject::operator=(const VariObject& other) = default;
+VariObject& VariObject::operator=(VariObject&& other) noexcept = default;
+VariObject::~VariObject() = default;
+
+void VariObject::reserve(size_t n)
+{
+    m_items.reserve(n);
+    if (n > INDEX_THRESHOLD && n * 2 > m_slots.size())
+        buildIndex(n);
+}
+
+void VariObject::clear()
+{
+    m_items.clear();
+    m_hashes.clear();
+    m_slots.clear();
+}
+
+template <typename Key>
+size_t VariObject::findPos(const Key& key) const
+{
+    if (m_slots.empty()) {
+        size_t pos = 0;
+        while (pos < m_items.size() && m_items[pos].first != key)
+            pos++;
+        return pos;
+    }
+    const uint64_t hash = KeyHash(key);
+    const size_t mask = m_slots.size() - 1;
+    for (size_t slot = hash & mask; m_slots[slot]; slot = (slot + 1) & mask) {
+        const size_t pos = m_slots[slot] - 1;
+        if (m_hashes[pos] == hash && m_items[pos].first == key)
+            return pos;
+    }
+    return m_items.size();
+}
+
+VariObject::iterator VariObject::find(std::string_view key)
+{
+    return m_items.begin() + findPos(key);
+}
+
+VariObject::const_iterator VariObject::find(std::string_view key) const
+{
+    return m_items.begin() + findPos(key);
+}
+
+VariObject::iterator VariObject::find(const VariKey& key)
+{
+    return m_items.begin() + findPos(key);
+}
+
+VariObject::const_iterator VariObject::find(const VariKey& key) const
+{
+    return m_items.begin() + findPos(key);
+}
+
+void VariObject::addToIndex(size_t pos)
+{
+    if ((pos + 1) * 2 > m_slots.size()) {
+        buildIndex(pos + 1);
+        return;
+    }
+    m_hashes.push_back(m_items[pos].first.hash());
+    const size_t mask = m_slots.size() - 1;
+    size_t slot = m_hashes[pos] & mask;
+    while (m_slots[slot])
+        slot = (slot + 1) & mask;
+    m_slots[slot] = pos + 1;
+}
+
+// Size the table for capacity members and index the ones present, hashing
+// only keys that have no cached hash yet
+void VariObject::buildIndex(size_t capacity)
+{
+    size_t slots = 1;
+    while (slots < capacity * 2)
+        slots <<= 1;
+    m_slots.assign(slots, 0);
+    m_hashes.reserve(capacity);
+    for (size_t pos = m_hashes.size(); pos < m_items.size(); pos++)
+        m_hashes.push_back(m_items[pos].first.hash());
+    for (size_t pos = 0; pos < m_items.size(); pos++) {
+        size_t slot = m_hashes[pos] & (slots - 1);
+        while (m_slots[slot])
+            slot = (slot + 1) & (slots - 1);
+        m_slots[slot] = pos + 1;
+    }
+}
+
+VariObject::iterator VariObject::append(VariKey key, VariValue val)
+{
+    const size_t pos = m_items.size();
+    m_items.emplace_back(std::move(key), std::move(val));
+    if (!m_slots.empty() || m_items.size() > INDEX_THRESHOLD)
+        addToIndex(pos);
+    return m_items.begin() + pos;
+}
+
+std::pair<VariObject::iterator, bool> VariObject::emplace(VariKey key, VariValue val)
+{
+    const size_t pos = findPos(key);
+    if (pos < m_items.size())
+        return {m_items.begin() + pos, false};
+    return {append(std::move(key), std::move(val)), true};
+}
+
+std::pair<VariObject::iterator, bool> VariObject::insert_or_assign(std::string_view key, VariValue val)
+{
+    const size_t pos = findPos(key);
+    if (pos < m_items.size()) {
+        m_items[pos].second = std::move(val);
+        return {m_items.begin() + pos, false};
+    }
+    return {append(VariKey(key), std::move(val)), true};
+}
+
+std::pair<VariObject::iterator, bool> VariObject::insert_or_assign(std::string&& key, VariValue val)
+{
+    const size_t pos = findPos(std::string_view(key));
+    if (pos < m_items.size()) {
+        m_items[pos].second = std::move(val);
+        return {m_items.begin() + pos, false};
+    }
+    return {append(VariKey(std::move(key)), std::move(val)), true};
+}
+
+VariObject::iterator VariObject::erase(const_iterator pos)
+{
+    const size_t erased = pos - m_items.begin();
+    iterator ret = m_items.erase(pos);
+    if (!m_slots.empty()) {
+        // Later members move up one, so reindex from the cached hashes
+        m_hashes.erase(m_hashes.begin() + erased);
+        buildIndex(m_slots.size() / 2);
+    }
+    return ret;
+}
+
+void VariObject::merge(VariObject&& other)
+{
+    reserve(size() + other.size());
+    for (value_type& item : other.m_items)
+        emplace(std::move(item.first), std::move(item.second));
+    other.clear();
+}
@@ -0,0 +1,207 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIOBJECT_H__
+#define __VARIOBJECT_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class VariValue;
+
+/**
+ * An object key. Keys of up to INLINE_MAX bytes are held inline, longer
+ * ones point to a shared, reference-counted copy of the text. Keys handed
+ * out by a VariSymbols table always point to the table's copy, so equal
+ * keys from one table share their text and compare by pointer.
+ */
+class VariKey
+{
+public:
+    static constexpr size_t INLINE_MAX = 15;
+
+    VariKey() { m_buf[INLINE_MAX] = 0; }
+    explicit VariKey(std::string_view key);
+    explicit VariKey(const std::string& key) : VariKey(std::string_view(key)) {}
+    // Takes over the text of a long key rather than copying it
+    explicit VariKey(std::string&& key);
+    explicit VariKey(const char *key) : VariKey(std::string_view(key)) {}
+    VariKey(const VariKey& other);
+    VariKey(VariKey&& other) noexcept;
+    VariKey& operator=(VariKey other) noexcept;
+    ~VariKey();
+
+    std::string_view view() const
+    {
+        if (const Symbol *sym = symbol())
+            return sym->text;
+        return std::string_view(m_buf, static_cast<unsigned char>(m_buf[INLINE_MAX]));
+    }
+    operator std::string_view() const { return view(); }
+    std::string str() const { return std::string(view()); }
+    size_t size() const { return view().size(); }
+    bool empty() const { return view().empty(); }
+    bool interned() const { const Symbol *sym = symbol(); return sym && sym->table; }
+    // As used by VariObject's index, cached for interned keys
+    uint64_t hash() const;
+    // The same for any text
+    static uint64_t hashOf(std::string_view key);
+
+    friend bool operator==(const VariKey& a, const VariKey& b)
+    {
+        const Symbol *symA = a.symbol();
+        const Symbol *symB = b.symbol();
+        if (symA && symB && symA->table && symA->table == symB->table)
+            return symA == symB;
+        return a.view() == b.view();
+    }
+    friend bool operator!=(const VariKey& a, const VariKey& b) { return !(a == b); }
+    friend bool operator==(const VariKey& a, std::string_view b) { return a.view() == b; }
+    friend bool operator!=(const VariKey& a, std::string_view b) { return a.view() != b; }
+    friend bool operator==(std::string_view a, const VariKey& b) { return a == b.view(); }
+    friend bool operator!=(std::string_view a, const VariKey& b) { return a != b.view(); }
+
+private:
+    friend class VariObject;
+    friend class VariSymbols;
+
+    struct Symbol
+    {
+        std::atomic<size_t> refs;
+        // Id of the VariSymbols table it belongs to, 0 for none
+        uint64_t table;
+        uint64_t hash;
+        std::string text;
+    };
+    static constexpr unsigned char SYMBOL = 0xff;
+
+    // The inline text with its length in the last byte, or a Symbol
+    // pointer at the start and SYMBOL in the last byte
+    alignas(Symbol*) char m_buf[INLINE_MAX + 1];
+
+    explicit VariKey(Symbol *sym);
+    Symbol *symbol() const
+    {
+        if (static_cast<unsigned char>(m_buf[INLINE_MAX]) != SYMBOL)
+            return nullptr;
+        Symbol *sym;
+        std::memcpy(&sym, m_buf, sizeof(sym));
+        return sym;
+    }
+};
+
+/**
+ * Table of interned object keys, for reading documents in which the same
+ * keys recur, such as arrays of similar objects. Every key read through the
+ * table is a pointer to its single copy, and lookups with a key from the
+ * table compare pointers only.
+ *
+ * Keys stay valid after the table is gone. A table isn't thread-safe, and
+ * keeps every distinct key it has seen: keys that are really data, like
+ * txids, are better read without one, or the table cleared between reads.
+ */
+class VariSymbols
+{
+public:
+    VariSymbols();
+    VariSymbols(const VariSymbols&) = delete;
+    VariSymbols& operator=(const VariSymbols&) = delete;
+
+    VariKey intern(std::string_view key);
+    size_t size() const { return m_symbols.size(); }
+    // Forget all keys. Those handed out remain valid, but no longer compare
+    // by pointer with the ones interned after.
+    void clear();
+
+private:
+    uint64_t m_id;
+    // Indexed by the symbol's own text
+    std::unordered_map<std::string_view, VariKey> m_symbols;
+};
+
+/**
+ * The members of a JSON object, kept in insertion order in one contiguous
+ * vector. Small objects are searched linearly. Past INDEX_THRESHOLD members
+ * an open-addressing hash table of positions is kept alongside, with each
+ * key's hash cached so that lookups rarely compare strings and growing the
+ * table doesn't rehash keys. The hash is seeded randomly once per process,
+ * which only affects where members land in the table, never their order.
+ *
+ * Keys are unique: inserting an existing key leaves it where it is. Keys
+ * must not be modified through an iterator.
+ */
+class VariObject
+{
+public:
+    using value_type = std::pair<VariKey, VariValue>;
+    using iterator = std::pmr::vector<value_type>::iterator;
+    using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+    // Largest object that is searched without an index
+    static constexpr size_t INDEX_THRESHOLD = 16;
+
+    VariObject();
+    explicit VariObject(std::pmr::memory_resource *resource);
+    VariObject(const VariObject& other);
+    VariObject(VariObject&& other) noexcept;
+    VariObject& operator=(const VariObject& other);
+    VariObject& operator=(VariObject&& other) noexcept;
+    ~VariObject();
+
+    iterator begin() { return m_items.begin(); }
+    iterator end() { return m_items.end(); }
+    const_iterator begin() const { return m_items.begin(); }
+    const_iterator end() const { return m_items.end(); }
+    const value_type *data() const { return m_items.data(); }
+    size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+
+    void reserve(size_t n);
+    void clear();
+
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    // Compares pointers only when both keys come from the same VariSymbols
+    iterator find(const VariKey& key);
+    const_iterator find(const VariKey& key) const;
+
+    // Add key at the end unless it is already present. Either way, returns
+    // the member with that key and whether it was added.
+    std::pair<iterator, bool> emplace(VariKey key, VariValue val);
+    // Replace the value of an existing key in place, or add it at the end.
+    // key is only copied in the latter case.
+    std::pair<iterator, bool> insert_or_assign(std::string_view key, VariValue val);
+    std::pair<iterator, bool> insert_or_assign(std::string&& key, VariValue val);
+    // Remove a member, keeping the others in order. Returns the member
+    // that followed it.
+    iterator erase(const_iterator pos);
+    // Move over the members of other whose keys aren't present here, in
+    // their order. other is left empty.
+    void merge(VariObject&& other);
+
+private:
+    std::pmr::vector<value_type> m_items;
+    // Both empty until the object outgrows INDEX_THRESHOLD or is reserved
+    // past it. m_slots holds 1 + the position of each member, 0 for a free
+    // slot, and is at most half full.
+    std::pmr::vector<uint64_t> m_hashes;
+    std::pmr::vector<uint32_t> m_slots;
+
+    // Key is std::string_view or VariKey
+    template <typename Key>
+    size_t findPos(const Key& key) const;
+    iterator append(VariKey key, VariValue val);
+    void addToIndex(size_t pos);
+    void buildIndex(size_t capacity);
+};
+
+#endif // __VARIOBJECT_H__
@@ -0,0 +1,192 @@
+// Copyright 2014 BitPay Inc.
+// Copyright 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://opensource.org/licenses/mit-license.php.
+
+#include "variparser.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+
+namespace {
+
+// Whether tok, a token cut off at the end of a chunk, could be the start of
+// a longer, valid one. Strings and numbers are only checked from position
+// from on, and escaped carries over whether the part of a string already
+// checked ends in a backslash.
+bool mayContinue(std::string_view tok, size_t from, bool& escaped)
+{
+    switch (tok[0]) {
+    case '"':
+        // Unterminated, as far as we can tell
+        for (size_t i = std::max<size_t>(from, 1); i < tok.size(); i++) {
+            if (escaped)
+                escaped = false;
+            else if (tok[i] == '\\')
+                escaped = true;
+            else if (tok[i] == '"' || (unsigned char)tok[i] < 0x20)
+                return false;
+        }
+        return true;
+    case 'n':
+        return std::string_view("null").substr(0, tok.size()) == tok;
+    case 't':
+        return std::string_view("true").substr(0, tok.size()) == tok;
+    case 'f':
+        return std::string_view("false").substr(0, tok.size()) == tok;
+    default:
+        return tok.find_first_not_of("0123456789-+.eE", from) == std::string_view::npos;
+    }
+}
+
+// End of the stretch of [raw, end) that may complete a token starting with
+// first: up to and including the closing quote for strings, or the next byte
+// that can't be part of a number or keyword otherwise. escaped is as for
+// mayContinue.
+const char *tokenBoundary(char first, const char *raw, const char *end, bool escaped)
+{
+    if (first == '"') {
+        for (const char *p = raw; p < end; p++) {
+            if (escaped)
+                escaped = false;
+            else if (*p == '\\')
+                escaped = true;
+            else if (*p == '"')
+                return p + 1;
+        }
+        return end;
+    }
+    const char *p = raw;
+    while (p < end && (isalnum((unsigned char)*p) || *p == '-' || *p == '+' || *p == '.'))
+        p++;
+    return p < end ? p + 1 : end;
+}
+
+} // namespace
+
+VariValue *VariValueBuilder::add(VariValue&& val)
+{
+    if (m_stack.empty()) {
+        m_root = std::move(val);
+        return &m_root;
+    }
+    VariValue *ret = nullptr;
+    varivalue::visit(varivalue::overloaded {
+        [&](array_t& arr) {
+            ret = &arr.emplace_back(std::move(val));
+        },
+        [&](object_t& obj) {
+            ret = &obj.emplace(std::move(m_key), std::move(val)).first->second;
+            m_key = VariKey();
+        },
+        [&](const auto&) {},
+    }, m_stack.back()->m_value);
+    return ret;
+}
+
+bool VariValueBuilder::on_string(std::string_view val)
+{
+    VariValue str;
+    str.m_value.emplace<varivalue::Box<std::string>>(m_resource, val);
+    add(std::move(str));
+    return true;
+}
+
+bool VariValueBuilder::open(VariValue::VType type)
+{
+    // A duplicate key hands back the existing value, which must be of the
+    // same type for the contents to be merged into it
+    VariValue container;
+    if (type == VariValue::VOBJ)
+        container.m_value.emplace<varivalue::Box<object_t>>(m_resource, m_resource);
+    else
+        container.m_value.emplace<varivalue::Box<array_t>>(m_resource, m_resource);
+    VariValue *val = add(std::move(container));
+    if (!val || val->getType() != type)
+        return false;
+    m_stack.push_back(val);
+    return true;
+}
+
+VariParser::VariParser(NodeAlloc nodes)
+    : m_pool(nodes == NODES_POOLED ? std::make_unique<std::pmr::unsynchronized_pool_resource>() : nullptr),
+      m_builder(m_root, m_pool ? m_pool.get() : std::pmr::get_default_resource())
+{
+}
+
+bool VariParser::tokens(const char *raw, const char *end, bool final)
+{
+    while (true) {
+        while (raw < end && json_isspace(*raw))
+            raw++;
+
+        std::string_view tokenVal;
+        unsigned int consumed;
+        jtokentype tok = getJsonToken(tokenVal, m_scratch, consumed, raw, end);
+        if (tok == JTOK_NONE)
+            return true;
+
+        // A token running into the end of the chunk may continue in the next one
+        bool atEnd = (tok == JTOK_ERR || raw + consumed == end);
+        if (!final && atEnd) {
+            m_escaped = false;
+            if (mayContinue(std::string_view(raw, end - raw), 0, m_escaped)) {
+                m_carry.assign(raw, end);
+                return true;
+            }
+        }
+
+        if (!m_reader.token(tok, tokenVal)) {
+            m_failed = true;
+            return false;
+        }
+        raw += consumed;
+    }
+}
+
+bool VariParser::feed(const char *raw, size_t len)
+{
+    if (m_failed)
+        return false;
+
+    const char *end = raw + len;
+    while (!m_carry.empty() && raw < end) {
+        // Only take as much of the new chunk as the cut-off token might need.
+        // While it stays incomplete only the new part is checked, so a long
+        // string fed in small chunks is still scanned in linear time.
+        const char *stop = tokenBoundary(m_carry[0], raw, end, m_escaped);
+        const size_t scanned = m_carry.size();
+        m_carry.append(raw, stop);
+        raw = stop;
+        if (raw == end && mayContinue(m_carry, scanned, m_escaped))
+            return true;
+        std::string carry = std::move(m_carry);
+        m_carry.clear();
+        if (!tokens(carry.data(), carry.data() + carry.size(), false))
+            return false;
+    }
+    return tokens(raw, end, false);
+}
+
+bool VariParser::finish()
+{
+    if (m_failed)
+        return false;
+
+    std::string carry = std::move(m_carry);
+    m_carry.clear();
+    if (!tokens(carry.data(), carry.data() + carry.size(), true))
+        return false;
+    return m_reader.done();
+}
+
+void VariParser::reset()
+{
+    m_root.clear();
+    m_builder.reset();
+    m_reader.reset();
+    m_failed = false;
+    m_carry.clear();
+    m_escaped = false;
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIPARSER_H__
+#define __VARIPARSER_H__
+
+#include "varivalue.h"
+#include "varivalue_index.h"
+#include "varivalue_sax.h"
+#include "varivalue_util.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * SaxReader handler that builds a VariValue tree. This is what
+ * VariValue::read() and VariParser use.
+ *
+ * As with the original reader, the first of several duplicate keys wins for
+ * scalars, while duplicate objects or arrays are merged into the first one.
+ */
+class VariValueBuilder
+{
+public:
+    // Objects and arrays are allocated from resource
+    explicit VariValueBuilder(VariValue& root, std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : m_root(root), m_resource(resource) {}
+
+    bool on_null() { add(VariValue()); return true; }
+    bool on_bool(bool val) { add(VariValue(val)); return true; }
+    bool on_number(std::string_view val) { add(VariValue(VariValue::VNUM, std::string(val))); return true; }
+    bool on_string(std::string_view val);
+    bool on_key(std::string_view key) { m_key = m_symbols ? m_symbols->intern(key) : VariKey(key); return true; }
+    bool on_object_begin() { return open(VariValue::VOBJ); }
+    bool on_object_end() { m_stack.pop_back(); return true; }
+    bool on_array_begin() { return open(VariValue::VARR); }
+    bool on_array_end() { m_stack.pop_back(); return true; }
+
+    void reset() { m_stack.clear(); m_key = VariKey(); }
+
+    // Intern object keys into symbols, or copy them if null
+    void setSymbols(VariSymbols *symbols) { m_symbols = symbols; }
+
+private:
+    VariValue& m_root;
+    std::pmr::memory_resource *m_resource;
+    VariSymbols *m_symbols{nullptr};
+    std::vector<VariValue*> m_stack;
+    VariKey m_key;
+
+    VariValue *add(VariValue&& val);
+    bool open(VariValue::VType type);
+};
+
+/**
+ * Incremental JSON reader. The document may be fed in chunks of any size,
+ * split anywhere (including inside a string, an escape or a multi-byte
+ * character), and produces the same VariValue as VariValue::read() on the
+ * concatenated input.
+ *
+ * Only the tokens cut off at the end of a chunk are buffered, the rest of
+ * each chunk is parsed straight into the tree.
+ *
+ * A parser is also meant to be kept around for reading many documents: its
+ * stacks and buffers keep their capacity between calls, so a parser that has
+ * warmed up only allocates for the tree itself.
+ */
+class VariParser
+{
+public:
+    // Where the objects and arrays of the trees read are allocated
+    enum NodeAlloc {
+        NODES_HEAP,
+        // From a pool owned by the parser, which recycles the memory of
+        // trees as they are freed into the ones read after them. Such trees
+        // must be destroyed or cleared before the parser is.
+        NODES_POOLED,
+    };
+
+    explicit VariParser(NodeAlloc nodes = NODES_HEAP);
+    VariParser(const VariParser&) = delete;
+    VariParser& operator=(const VariParser&) = delete;
+
+    // Parse the next chunk. Returns false as soon as the input is known to
+    // be invalid, after which all further calls fail too.
+    bool feed(const char *raw, size_t len);
+    bool feed(std::string_view raw) { return feed(raw.data(), raw.size()); }
+
+    // Signal the end of input. Returns true if a complete, valid document
+    // was read.
+    bool finish();
+
+    // The document read so far
+    VariValue& value() { return m_root; }
+
+    // Intern the keys of objects read from now on into symbols, or copy
+    // them again if null. symbols must not be used elsewhere meanwhile.
+    void internKeys(VariSymbols *symbols) { m_builder.setSymbols(symbols); }
+
+    // Drop all state and start over with a new document
+    void reset();
+
+    // Read a complete document into val, with the same result as
+    // val.read(raw, len, mode), which wraps a per-thread parser. Drops any
+    // document being fed.
+    bool read(VariValue& val, const char *raw, size_t len, VariValue::ReadMode mode = VariValue::READ_SEQUENTIAL);
+    bool read(VariValue& val, std::string_view raw, VariValue::ReadMode mode = VariValue::READ_SEQUENTIAL)
+    {
+        return read(val, raw.data(), raw.size(), mode);
+    }
+
+private:
+    // Buffers larger than this are released after a read
+    static constexpr size_t KEEP_MAX = 1 << 20;
+
+    // Declared first so that it outlives m_root
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> m_pool;
+    VariValue m_root;
+    VariValueBuilder m_builder;
+    SaxReader<VariValueBuilder> m_reader{m_builder};
+    bool m_failed{false};
+
+    // Start of a token cut off by the end of the previous chunk
+    std::string m_carry;
+    // Whether m_carry is a string ending in an unfinished escape
+    bool m_escaped{false};
+    std::string m_scratch;
+    JsonIndex m_index;
+
+    bool tokens(const char *raw, const char *end, bool final);
+};
+
+#endif // __VARIPARSER_H__
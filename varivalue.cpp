@@ -9,7 +9,7 @@ const VariValue NullUniValue;
 
 VariValue::VariValue(UniValue::VType initialType, std::string initialStr) : VariValue(initialType)
 {
-    std::visit(varivalue::overloaded {
+    varivalue::visit(varivalue::overloaded {
         [&](std::string& str) { str = std::move(initialStr); },
         [&](VariNum& num) { num.setNumStr(std::move(initialStr)); },
         [&](const auto&)  {},
@@ -101,6 +101,15 @@ bool VariValue::setFloat(double val)
     return false;
 }
 
+bool VariValue::setFixed(int64_t val, int decimals)
+{
+    if (num_t num; num.setFixed(val, decimals)) {
+        m_value = std::move(num);
+        return true;
+    }
+    return false;
+}
+
 bool VariValue::setStr(std::string val)
 {
     m_value = std::move(val);
@@ -130,11 +139,11 @@ bool VariValue::setObject()
 
 enum VariValue::VType VariValue::getType() const
 {
-    return std::visit(varivalue::overloaded {
+    return varivalue::visit(varivalue::overloaded {
         [](const object_t&) { return VOBJ;},
         [](const array_t&) { return VARR;},
         [](const std::string&) { return VSTR;},
-        [](num_t) { return VNUM;},
+        [](const num_t&) { return VNUM;},
         [](bool) { return VBOOL;},
         [](std::monostate)  { return VNULL;},
         }, m_value);
@@ -142,7 +151,7 @@ enum VariValue::VType VariValue::getType() const
 
 std::string VariValue::getValStr() const
 {
-    return std::visit(varivalue::overloaded {
+    return varivalue::visit(varivalue::overloaded {
         [&](const std::string& val) { return val;},
         [&](const num_t& num) { return num.getValStr();},
         [&](const bool& val) -> std::string { return val ? "1" : "";},
@@ -152,7 +161,7 @@ std::string VariValue::getValStr() const
 
 bool VariValue::empty() const
 {
-    return std::visit(varivalue::overloaded {
+    return varivalue::visit(varivalue::overloaded {
         [&](const object_t& obj) { return obj.empty();},
         [&](const array_t& arr) { return arr.empty();},
         [&](const auto&)  { return true;},
@@ -161,7 +170,7 @@ bool VariValue::empty() const
 
 size_t VariValue::size() const
 {
-    return std::visit(varivalue::overloaded {
+    return varivalue::visit(varivalue::overloaded {
         [&](const object_t& obj) { return obj.size();},
         [&](const array_t& arr) { return arr.size();},
         [&](const auto&) -> size_t  { return 0; },
@@ -170,8 +179,8 @@ size_t VariValue::size() const
 
 void VariValue::reserve(size_t n) {
 
-    std::visit(varivalue::overloaded {
-        [&](object_t&) {/* TODO: fill in when object is unordered_map */ },
+    varivalue::visit(varivalue::overloaded {
+        [&](object_t& obj) { obj.reserve(n); },
         [&](array_t& arr) { arr.reserve(n); },
         [&](std::string& str) {str.reserve(n); },
         [&](const auto&) {},
@@ -189,15 +198,17 @@ bool VariValue::getBool() const
 
 void VariValue::getObjMap(std::map<std::string,VariValue>& kv) const
 {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
-        kv = *ret;
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        kv.clear();
+        for (const auto& [key, val] : *ret)
+            kv.emplace(key.str(), val);
     }
 }
 
 
 bool VariValue::checkObject(const std::map<std::string,VariValue::VType>& keytypes) const
 {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
         for (const auto& [key, type] : keytypes) {
             if (auto match = ret->find(key); match != ret->end()) {
                 if (match->second.getType() != type) {
@@ -210,9 +221,20 @@ bool VariValue::checkObject(const std::map<std::string,VariValue::VType>& keytyp
     return false;
 }
 
-const VariValue& VariValue::operator[](const std::string& key) const
+const VariValue& VariValue::operator[](std::string_view key) const
+{
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        auto it = ret->find(key);
+        if (it != ret->end()) {
+            return it->second;
+        }
+    }
+    return NullUniValue;
+}
+
+const VariValue& VariValue::operator[](const VariKey& key) const
 {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
         auto it = ret->find(key);
         if (it != ret->end()) {
             return it->second;
@@ -223,7 +245,7 @@ const VariValue& VariValue::operator[](const std::string& key) const
 
 const VariValue& VariValue::operator[](size_t index) const
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
         if (index < ret->size()) {
             return ret->operator[](index);
         }
@@ -233,9 +255,9 @@ const VariValue& VariValue::operator[](size_t index) const
 
 
 
-bool VariValue::exists(const std::string& key) const
+bool VariValue::exists(std::string_view key) const
 {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
         if (ret->find(key) != ret->end()) {
             return true;
         }
@@ -245,7 +267,7 @@ bool VariValue::exists(const std::string& key) const
 
 bool VariValue::isNull() const
 {
-    return std::holds_alternative<std::monostate>(m_value);
+    return varivalue::holds_alternative<std::monostate>(m_value);
 }
 
 bool VariValue::isTrue() const
@@ -266,112 +288,163 @@ bool VariValue::isFalse() const
 
 bool VariValue::isBool() const
 {
-    return std::holds_alternative<bool>(m_value);
+    return varivalue::holds_alternative<bool>(m_value);
 }
 
 bool VariValue::isStr() const
 {
-    return std::holds_alternative<std::string>(m_value);
+    return varivalue::holds_alternative<std::string>(m_value);
 }
 
 bool VariValue::isNum() const
 {
-    return std::holds_alternative<num_t>(m_value);
+    return varivalue::holds_alternative<num_t>(m_value);
 }
 
 bool VariValue::isArray() const
 {
-    return std::holds_alternative<array_t>(m_value);
+    return varivalue::holds_alternative<array_t>(m_value);
 }
 
 bool VariValue::isObject() const
 {
-    return std::holds_alternative<object_t>(m_value);
+    return varivalue::holds_alternative<object_t>(m_value);
+}
+
+void VariValue::__pushKV(std::string_view key, VariValue val)
+{
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, std::move(val));
+    }
 }
 
-void VariValue::__pushKV(std::string key, VariValue val)
+void VariValue::__pushKV(std::string&& key, VariValue val)
 {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
         ret->insert_or_assign(std::move(key), std::move(val));
     }
 }
 
-bool VariValue::pushKV(std::string key, std::string val) {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
-        ret->insert_or_assign(std::move(key), VariValue{std::move(val)});
+bool VariValue::pushKV(std::string_view key, std::string val) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, VariValue{std::move(val)});
         return true;
     }
     return false;
 }
 
-bool VariValue::pushKV(std::string key, const char *val) {
+bool VariValue::pushKV(std::string_view key, const char *val) {
     if (val) {
-        return pushKV(std::move(key), std::string(val));
+        return pushKV(key, std::string(val));
+    }
+    return false;
+}
+
+bool VariValue::pushKV(std::string_view key, int64_t val) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, VariValue{val});
+        return true;
     }
     return false;
 }
 
-bool VariValue::pushKV(std::string key, int64_t val) {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
-        ret->insert_or_assign(std::move(key), VariValue{val});
+bool VariValue::pushKV(std::string_view key, uint64_t val) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, VariValue{val});
         return true;
     }
     return false;
 }
 
-bool VariValue::pushKV(std::string key, uint64_t val) {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
-        ret->insert_or_assign(std::move(key), VariValue{val});
+bool VariValue::pushKV(std::string_view key, bool val) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, VariValue{val});
         return true;
     }
     return false;
 }
 
-bool VariValue::pushKV(std::string key, bool val) {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
-        ret->insert_or_assign(std::move(key), VariValue{val});
+bool VariValue::pushKV(std::string_view key, int val) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, VariValue{val});
         return true;
     }
     return false;
 }
 
-bool VariValue::pushKV(std::string key, int val) {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
-        ret->insert_or_assign(std::move(key), VariValue{val});
+bool VariValue::pushKV(std::string_view key, double val) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, VariValue{val});
         return true;
     }
     return false;
 }
 
-bool VariValue::pushKV(std::string key, double val) {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
-        ret->insert_or_assign(std::move(key), VariValue{val});
+bool VariValue::pushKV(std::string_view key, std::monostate) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, VariValue{});
         return true;
     }
     return false;
 }
 
-bool VariValue::pushKV(std::string key, std::monostate) {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
-        ret->insert_or_assign(std::move(key), VariValue{});
+bool VariValue::pushKV(std::string_view key, VariValue obj)
+{
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
+        ret->insert_or_assign(key, std::move(obj));
         return true;
     }
     return false;
 }
 
-bool VariValue::pushKV(std::string key, VariValue obj)
+bool VariValue::pushKV(std::string&& key, VariValue obj)
 {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
         ret->insert_or_assign(std::move(key), std::move(obj));
         return true;
     }
     return false;
 }
 
+bool VariValue::pushKV(std::string&& key, std::string val) {
+    return pushKV(std::move(key), VariValue{std::move(val)});
+}
+
+bool VariValue::pushKV(std::string&& key, const char *val) {
+    if (val) {
+        return pushKV(std::move(key), std::string(val));
+    }
+    return false;
+}
+
+bool VariValue::pushKV(std::string&& key, int64_t val) {
+    return pushKV(std::move(key), VariValue{val});
+}
+
+bool VariValue::pushKV(std::string&& key, uint64_t val) {
+    return pushKV(std::move(key), VariValue{val});
+}
+
+bool VariValue::pushKV(std::string&& key, bool val) {
+    return pushKV(std::move(key), VariValue{val});
+}
+
+bool VariValue::pushKV(std::string&& key, int val) {
+    return pushKV(std::move(key), VariValue{val});
+}
+
+bool VariValue::pushKV(std::string&& key, double val) {
+    return pushKV(std::move(key), VariValue{val});
+}
+
+bool VariValue::pushKV(std::string&& key, std::monostate) {
+    return pushKV(std::move(key), VariValue{});
+}
+
 bool VariValue::pushKVs(VariValue obj)
 {
-    if(auto lhs = std::get_if<object_t>(&m_value)) {
-        if(auto rhs = std::get_if<object_t>(&obj.m_value)) {
+    if(auto lhs = varivalue::get_if<object_t>(&m_value)) {
+        if(auto rhs = varivalue::get_if<object_t>(&obj.m_value)) {
             lhs->merge(std::move(*rhs));
             return true;
         }
@@ -381,7 +454,7 @@ bool VariValue::pushKVs(VariValue obj)
 
 bool VariValue::push_back(VariValue val)
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
         ret->push_back(std::move(val));
         return true;
     }
@@ -390,7 +463,7 @@ bool VariValue::push_back(VariValue val)
 
 bool VariValue::push_back(std::string val)
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
         ret->emplace_back(std::move(val));
         return true;
     }
@@ -407,7 +480,7 @@ bool VariValue::push_back(const char *val)
 
 bool VariValue::push_back(uint64_t val)
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
         ret->emplace_back(val);
         return true;
     }
@@ -416,7 +489,7 @@ bool VariValue::push_back(uint64_t val)
 
 bool VariValue::push_back(int64_t val)
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
         ret->emplace_back(val);
         return true;
     }
@@ -425,7 +498,7 @@ bool VariValue::push_back(int64_t val)
 
 bool VariValue::push_back(bool val)
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
         ret->emplace_back(val);
         return true;
     }
@@ -434,7 +507,7 @@ bool VariValue::push_back(bool val)
 
 bool VariValue::push_back(int val)
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
         ret->emplace_back(val);
         return true;
     }
@@ -443,7 +516,7 @@ bool VariValue::push_back(int val)
 
 bool VariValue::push_back(double val)
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
         ret->emplace_back(val);
         return true;
     }
@@ -452,8 +525,8 @@ bool VariValue::push_back(double val)
 
 bool VariValue::push_back(std::monostate)
 {
-    if(auto ret = std::get_if<array_t>(&m_value)) {
-        ret->push_back(VariValue{});
+    if(auto ret = varivalue::get_if<array_t>(&m_value)) {
+        ret->emplace_back();
         return true;
     }
     return false;
@@ -461,20 +534,150 @@ bool VariValue::push_back(std::monostate)
 
 bool VariValue::push_backV(std::vector<VariValue> vec)
 {
-    if(auto lhs = std::get_if<array_t>(&m_value)) {
-        lhs->insert(lhs->end(), vec.begin(), vec.end());
+    if(auto lhs = varivalue::get_if<array_t>(&m_value)) {
+        lhs->insert(lhs->end(), std::make_move_iterator(vec.begin()), std::make_move_iterator(vec.end()));
         return true;
     }
     return false;
 }
 
 
+const VariValue *VariValue::begin() const
+{
+    const array_t *arr = varivalue::get_if<array_t>(&m_value);
+    return arr ? arr->data() : nullptr;
+}
+
+const VariValue *VariValue::end() const
+{
+    const array_t *arr = varivalue::get_if<array_t>(&m_value);
+    return arr ? arr->data() + arr->size() : nullptr;
+}
+
+varivalue::Range<const object_t::value_type*> VariValue::items() const
+{
+    const object_t *obj = varivalue::get_if<object_t>(&m_value);
+    if (!obj)
+        return {nullptr, nullptr, 0};
+    return {obj->data(), obj->data() + obj->size(), obj->size()};
+}
+
+varivalue::Range<varivalue::KeyIterator> VariValue::keys() const
+{
+    const auto members = items();
+    return {varivalue::KeyIterator(members.begin()), varivalue::KeyIterator(members.end()), members.size()};
+}
+
+varivalue::Range<varivalue::ValueIterator> VariValue::values() const
+{
+    if (const array_t *arr = varivalue::get_if<array_t>(&m_value))
+        return {varivalue::ValueIterator(begin()), varivalue::ValueIterator(end()), arr->size()};
+    const auto members = items();
+    return {varivalue::ValueIterator(members.begin()), varivalue::ValueIterator(members.end()), members.size()};
+}
+
+VariValue *VariValue::find_mut(std::string_view key)
+{
+    if (!isObject())
+        return nullptr;
+    object_t& obj = *varivalue::get_if<object_t>(&m_value);
+    auto it = obj.find(key);
+    return it == obj.end() ? nullptr : &it->second;
+}
+
+VariValue& VariValue::at(std::string_view key)
+{
+    if (!isObject())
+        throw std::runtime_error("JSON value is not an object as expected");
+    if (VariValue *val = find_mut(key))
+        return *val;
+    throw std::runtime_error("JSON object has no key " + std::string(key));
+}
+
+VariValue& VariValue::at(size_t index)
+{
+    if (!isArray())
+        throw std::runtime_error("JSON value is not an array as expected");
+    array_t& arr = *varivalue::get_if<array_t>(&m_value);
+    if (index >= arr.size())
+        throw std::runtime_error("JSON array index " + std::to_string(index) + " out of range");
+    return arr[index];
+}
+
+VariValue VariValue::take(std::string_view key)
+{
+    VariValue ret;
+    if (VariValue *val = find_mut(key)) {
+        ret = std::move(*val);
+        object_t& obj = *varivalue::get_if<object_t>(&m_value);
+        obj.erase(obj.find(key));
+    }
+    return ret;
+}
+
+bool VariValue::erase(std::string_view key)
+{
+    if (!exists(key))
+        return false;
+    object_t& obj = *varivalue::get_if<object_t>(&m_value);
+    obj.erase(obj.find(key));
+    return true;
+}
+
+bool VariValue::erase(size_t index)
+{
+    if (!isArray() || index >= size())
+        return false;
+    array_t& arr = *varivalue::get_if<array_t>(&m_value);
+    arr.erase(arr.begin() + index);
+    return true;
+}
+
+std::vector<VariValue> VariValue::release_array() &&
+{
+    if (!isArray())
+        throw std::runtime_error("JSON value is not an array as expected");
+    array_t& arr = *varivalue::get_if<array_t>(&m_value);
+    std::vector<VariValue> ret(std::make_move_iterator(arr.begin()), std::make_move_iterator(arr.end()));
+    clear();
+    return ret;
+}
+
+std::string VariValue::release_str() &&
+{
+    if (!isStr())
+        throw std::runtime_error("JSON value is not a string as expected");
+    std::string ret = std::move(*varivalue::get_if<std::string>(&m_value));
+    clear();
+    return ret;
+}
+
+void VariValue::share()
+{
+    std::visit(varivalue::overloaded {
+        [](varivalue::Box<object_t>& obj) {
+            obj.share([](object_t& members) {
+                for (auto& member : members)
+                    member.second.share();
+            });
+        },
+        [](varivalue::Box<array_t>& arr) {
+            arr.share([](array_t& elems) {
+                for (VariValue& elem : elems)
+                    elem.share();
+            });
+        },
+        [](varivalue::Box<std::string>& str) { str.share([](std::string&) {}); },
+        [](auto&) {},
+    }, m_value);
+}
+
 std::vector<std::string> VariValue::getKeys() const
 {
-    if(auto ret = std::get_if<object_t>(&m_value)) {
+    if(auto ret = varivalue::get_if<object_t>(&m_value)) {
         std::vector<std::string> keys;
         for (auto&& i : *ret) {
-            keys.push_back(i.first);
+            keys.push_back(i.first.str());
         }
         return keys;
     }
@@ -483,8 +686,8 @@ std::vector<std::string> VariValue::getKeys() const
 
 std::vector<VariValue> VariValue::getValues() const
 {
-    return std::visit(varivalue::overloaded {
-        [&](const array_t& arr) { return arr;},
+    return varivalue::visit(varivalue::overloaded {
+        [&](const array_t& arr) { return std::vector<VariValue>(arr.begin(), arr.end());},
         [&](const object_t& obj) {
             std::vector<VariValue> values;
             values.reserve(obj.size());
@@ -510,7 +713,7 @@ bool VariValue::get_bool() const
 const std::string& VariValue::get_str() const
 {
     
-    if(auto ret = std::get_if<std::string>(&m_value)) {
+    if(auto ret = varivalue::get_if<std::string>(&m_value)) {
         return *ret;
     }
     throw std::runtime_error("JSON value is not a string as expected");
@@ -540,9 +743,53 @@ double VariValue::get_real() const
     throw std::runtime_error("JSON value is not a number as expected");
 }
 
+int64_t VariValue::get_fixed(int decimals) const
+{
+    if(auto num = std::get_if<num_t>(&m_value)) {
+        return num->get_fixed(decimals);
+    }
+    throw std::runtime_error("JSON value is not a number as expected");
+}
+
+template <typename T, typename Get>
+void VariValue::getNumArray(std::vector<T>& out, Get get) const
+{
+    const array_t *arr = varivalue::get_if<array_t>(&m_value);
+    if (!arr)
+        throw std::runtime_error("JSON value is not an array as expected");
+
+    out.clear();
+    out.reserve(arr->size());
+    for (size_t i = 0; i < arr->size(); i++) {
+        const num_t *num = std::get_if<num_t>(&(*arr)[i].m_value);
+        if (!num)
+            throw std::runtime_error("JSON array element " + std::to_string(i) + " is not a number as expected");
+        try {
+            out.push_back(get(*num));
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(std::string(e.what()) + " at array element " + std::to_string(i));
+        }
+    }
+}
+
+void VariValue::get_int64_array(std::vector<int64_t>& out) const
+{
+    getNumArray(out, [](const num_t& num) { return num.get_int64(); });
+}
+
+void VariValue::get_real_array(std::vector<double>& out) const
+{
+    getNumArray(out, [](const num_t& num) { return num.get_real(); });
+}
+
+void VariValue::get_fixed_array(std::vector<int64_t>& out, int decimals) const
+{
+    getNumArray(out, [decimals](const num_t& num) { return num.get_fixed(decimals); });
+}
+
 const VariValue& VariValue::get_obj() const
 {
-    if(auto num = std::get_if<object_t>(&m_value)) {
+    if(auto num = varivalue::get_if<object_t>(&m_value)) {
         return *this;
     }
     throw std::runtime_error("JSON value is not an object as expected");
@@ -550,7 +797,7 @@ const VariValue& VariValue::get_obj() const
 
 const VariValue& VariValue::get_array() const
 {
-    if(auto num = std::get_if<array_t>(&m_value)) {
+    if(auto num = varivalue::get_if<array_t>(&m_value)) {
         return *this;
     }
     throw std::runtime_error("JSON value is not an array as expected");
@@ -561,9 +808,20 @@ VariValue::VType VariValue::type() const
     return getType();
 }
 
-const VariValue& find_value(const VariValue& obj, const std::string& name)
+const VariValue& find_value(const VariValue& obj, std::string_view name)
+{
+    if(auto ret = varivalue::get_if<object_t>(&obj.m_value)) {
+        auto it = ret->find(name);
+        if (it != ret->end()) {
+            return it->second;
+        }
+    }
+    return NullUniValue;
+}
+
+const VariValue& find_value(const VariValue& obj, const VariKey& name)
 {
-    if(auto ret = std::get_if<object_t>(&obj.m_value)) {
+    if(auto ret = varivalue::get_if<object_t>(&obj.m_value)) {
         auto it = ret->find(name);
         if (it != ret->end()) {
             return it->second;
@@ -572,7 +830,7 @@ const VariValue& find_value(const VariValue& obj, const std::string& name)
     return NullUniValue;
 }
 
-std::string VariValue::write(unsigned int prettyIndent, unsigned int indentLevel) const
+std::string VariValue::write(unsigned int prettyIndent, unsigned int indentLevel, WriteOrder order) const
 {
     std::string s;
     s.reserve(1024);
@@ -581,9 +839,9 @@ std::string VariValue::write(unsigned int prettyIndent, unsigned int indentLevel
     if (modIndent == 0)
         modIndent = 1;
 
-    std::visit(varivalue::overloaded {
-        [&](const object_t& val) { return writeObject(val, s, prettyIndent, modIndent);},
-        [&](const array_t& val) { return writeArray(val, s, prettyIndent, modIndent);},
+    varivalue::visit(varivalue::overloaded {
+        [&](const object_t& val) { return writeObject(val, s, prettyIndent, modIndent, order);},
+        [&](const array_t& val) { return writeArray(val, s, prettyIndent, modIndent, order);},
         [&](const std::string val) { return writeString(val, s);},
         [&](const num_t& val) { return writeNum(val, s);},
         [&](bool val) { return writeBool(val, s);},
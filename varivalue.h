@@ -6,37 +6,207 @@
 #define __VARIVALUE_H__
 
 #include "varinum.h"
+#include "variobject.h"
 
+#include <atomic>
 #include <variant>
 #include <cstddef>
+#include <iterator>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <map>
+#include <memory_resource>
 
 namespace varivalue {
 // visitor helper type. From: https://en.cppreference.com/w/cpp/utility/variant/visit
 template<class... Ts> struct overloaded final : Ts... { using Ts::operator()...; };
 // explicit deduction guide (not needed as of C++20)
 template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+
+/**
+ * Pointer with value semantics that keeps containers and strings to a
+ * single word inside json_t. The value is allocated from a memory_resource,
+ * the default one unless given, which is kept next to it along with an
+ * atomic reference count.
+ *
+ * Copies are deep unless the value has been made shareable with share(),
+ * see VariValue::share(). A copy of a shareable value only bumps the count,
+ * and non-const access first copies the value if it is shared. As copying
+ * a container copies its members the same way, a change detaches only the
+ * path down to it. Only values allocated from the default resource can be
+ * made shareable: values in any other resource, such as a VariDocument's
+ * arena, can't outlive it. Only empty once moved from.
+ */
+template <typename T>
+class Box
+{
+public:
+    Box() : Box(std::pmr::get_default_resource()) {}
+    Box(T&& val) : Box(std::pmr::get_default_resource(), std::move(val)) {}
+    Box(const T& val) : Box(std::pmr::get_default_resource(), val) {}
+    template <typename... Args>
+    explicit Box(std::pmr::memory_resource *resource, Args&&... args)
+    {
+        void *mem = resource->allocate(sizeof(Block), alignof(Block));
+        try {
+            m_block = new (mem) Block{resource, {1}, resource == std::pmr::get_default_resource(), false,
+                                      T(std::forward<Args>(args)...)};
+        } catch (...) {
+            resource->deallocate(mem, sizeof(Block), alignof(Block));
+            throw;
+        }
+    }
+    Box(const Box& other)
+    {
+        if (other.m_block->shareable) {
+            m_block = other.m_block;
+            m_block->refs.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            *this = Box(other.get());
+        }
+    }
+    Box(Box&& other) noexcept : m_block(other.m_block) { other.m_block = nullptr; }
+    Box& operator=(Box other) noexcept { std::swap(m_block, other.m_block); return *this; }
+    ~Box()
+    {
+        if (m_block && m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::pmr::memory_resource *resource = m_block->resource;
+            m_block->~Block();
+            resource->deallocate(m_block, sizeof(Block), alignof(Block));
+        }
+    }
+
+    const T& get() const { return m_block->value; }
+    // For writing: detaches from other owners first. The reference may be
+    // kept and written through after the Box is next copied, so the value
+    // is no longer shareable until share() is called again.
+    T& mut()
+    {
+        if (m_block->refs.load(std::memory_order_acquire) != 1)
+            *this = Box(get());
+        else
+            m_block->shareable = false;
+        return m_block->value;
+    }
+
+    T& operator*() { return mut(); }
+    const T& operator*() const { return get(); }
+    T *operator->() { return &mut(); }
+    const T *operator->() const { return &get(); }
+
+    // Let copies share the value from now on. Unless it already was
+    // shareable, fn is first called on the value, which isn't shared yet.
+    template <typename Fn>
+    void share(Fn&& fn)
+    {
+        if (m_block->shareable || !m_block->defaultResource)
+            return;
+        fn(m_block->value);
+        m_block->shareable = true;
+    }
+
+private:
+    struct Block
+    {
+        std::pmr::memory_resource *resource;
+        std::atomic<size_t> refs;
+        // Whether resource was the default resource when the value was
+        // allocated. Other resources, a VariDocument's arena or a pooled
+        // VariParser's pool, are owned by an object and freed with it, so a
+        // copy that shares the value could outlive its memory. The default
+        // resource is the one with process lifetime, whichever it is.
+        bool defaultResource;
+        // Set by share() and cleared by mut(), both only while refs is 1
+        bool shareable;
+        T value;
+    };
+    Block *m_block{nullptr};
+};
 }
 
 class VariValue;
 class VariNum;
 using num_t = VariNum;
-using array_t = std::vector<VariValue>;
-using object_t = std::map<std::string, VariValue>;
-using json_t = std::variant<std::monostate, object_t, array_t, std::string, num_t, bool>;
+// Containers draw from a memory_resource, see VariDocument
+using array_t = std::pmr::vector<VariValue>;
+// Objects keep their members in insertion order, so write() puts keys out
+// in the order they were read or pushed unless asked to sort them; see
+// VariObject and VariValue::WriteOrder
+using object_t = VariObject;
+// Every alternative is at most a word, so a VariValue takes 16 bytes
+using json_t = std::variant<std::monostate, varivalue::Box<object_t>, varivalue::Box<array_t>,
+                            varivalue::Box<std::string>, num_t, bool>;
+
+namespace varivalue {
+template <typename T> struct Stored { using type = T; };
+template <> struct Stored<object_t> { using type = Box<object_t>; };
+template <> struct Stored<array_t> { using type = Box<array_t>; };
+template <> struct Stored<std::string> { using type = Box<std::string>; };
+
+template <typename T> T& unbox(T& val) { return val; }
+template <typename T> T& unbox(Box<T>& val) { return *val; }
+template <typename T> const T& unbox(const Box<T>& val) { return *val; }
+
+// Counterparts of the std::variant functions that look through Box, so
+// that code can deal in object_t, array_t and std::string directly
+template <typename T>
+T *get_if(json_t *val)
+{
+    auto *stored = std::get_if<typename Stored<T>::type>(val);
+    return stored ? &unbox(*stored) : nullptr;
+}
+
+template <typename T>
+const T *get_if(const json_t *val)
+{
+    auto *stored = std::get_if<typename Stored<T>::type>(val);
+    return stored ? &unbox(*stored) : nullptr;
+}
+
+template <typename T>
+bool holds_alternative(const json_t& val)
+{
+    return std::holds_alternative<typename Stored<T>::type>(val);
+}
+
+template <typename Fn, typename Json>
+decltype(auto) visit(Fn&& fn, Json& val)
+{
+    return std::visit([&](auto& alt) -> decltype(auto) { return fn(unbox(alt)); }, val);
+}
+}
+
+namespace varivalue {
+template <typename It> class Range;
+class KeyIterator;
+class ValueIterator;
+}
 
 class VariValue {
 public:
     enum VType { VNULL, VOBJ, VARR, VSTR, VNUM, VBOOL, };
 
+    // READ_INDEXED runs a vectorized pass that indexes every token before
+    // building the tree. READ_PARALLEL does the same, then splits a large
+    // top-level array between threads, see readParallel(). All modes accept
+    // and produce exactly the same.
+    enum ReadMode { READ_SEQUENTIAL, READ_INDEXED, READ_PARALLEL, };
+
+    // Order in which write() puts out object members: WRITE_INSERTION keeps
+    // the order they were read or pushed in, WRITE_SORTED sorts them by key
+    // bytewise, as when objects were backed by a std::map.
+    enum WriteOrder { WRITE_INSERTION, WRITE_SORTED, };
+
+    // Smallest piece of an array that readParallel() hands to a thread
+    static constexpr size_t PARALLEL_MIN_SLICE = 64 * 1024;
+
     constexpr VariValue(VType initialType) {
         switch (initialType) {
             case VNULL: m_value = std::monostate(); break;
-            case VOBJ: m_value = object_t{}; break;
-            case VARR: m_value = array_t{}; break;
-            case VSTR: m_value = std::string(); break;
+            case VOBJ: m_value = varivalue::Box<object_t>(); break;
+            case VARR: m_value = varivalue::Box<array_t>(); break;
+            case VSTR: m_value = varivalue::Box<std::string>(); break;
             case VNUM: m_value = num_t{}; break;
             case VBOOL: m_value = bool{}; break;
             default: m_value = std::monostate(); break;
@@ -46,6 +216,18 @@ public:
     VariValue(VType initialType, std::string initialStr);
 
     constexpr VariValue() {};
+    VariValue(const VariValue& other) = default;
+    // Leaves other null
+    VariValue(VariValue&& other) noexcept : m_value(std::move(other.m_value)) { other.m_value = std::monostate(); }
+    VariValue& operator=(const VariValue& other) = default;
+    VariValue& operator=(VariValue&& other) noexcept
+    {
+        // other may live inside the value being replaced
+        json_t val(std::move(other.m_value));
+        other.m_value = std::monostate();
+        m_value = std::move(val);
+        return *this;
+    }
     constexpr explicit VariValue(bool val) : m_value{val}{}
     explicit VariValue(uint64_t val);
     explicit VariValue(int64_t val);
@@ -61,6 +243,9 @@ public:
     bool setInt(int64_t val);
     bool setInt(int val);
     bool setFloat(double val);
+    // Amount given as an integer scaled by 10^decimals, e.g. 150000000
+    // with 8 decimals is written as 1.50000000
+    bool setFixed(int64_t val, int decimals);
     bool setStr(std::string val);
     bool setArray();
     bool setObject();
@@ -77,9 +262,12 @@ public:
     bool getBool() const;
     void getObjMap(std::map<std::string,VariValue>& kv) const;
     bool checkObject(const std::map<std::string,VariValue::VType>& memberTypes) const;
-    const VariValue& operator[](const std::string& key) const;
+    const VariValue& operator[](std::string_view key) const;
+    // Compares pointers only if key and this object's keys were interned in
+    // the same VariSymbols
+    const VariValue& operator[](const VariKey& key) const;
     const VariValue& operator[](size_t index) const;
-    bool exists(const std::string& key) const;
+    bool exists(std::string_view key) const;
 
     bool isNull() const;
     bool isTrue() const;
@@ -90,16 +278,38 @@ public:
     bool isArray() const;
     bool isObject() const;
 
-    void __pushKV(std::string key, VariValue val);
-    bool pushKV(std::string key, std::string val);
-    bool pushKV(std::string key, const char *val_);
-    bool pushKV(std::string key, int64_t val_);
-    bool pushKV(std::string key, uint64_t val_);
-    bool pushKV(std::string key, bool val_);
-    bool pushKV(std::string key, int val_);
-    bool pushKV(std::string key, double val_);
-    bool pushKV(std::string key, std::monostate);
-    bool pushKV(std::string key, VariValue obj);
+    // Keys passed by view are only copied into the object when they are new,
+    // a std::string key is moved in. Literal keys take the view overloads.
+    void __pushKV(std::string_view key, VariValue val);
+    void __pushKV(std::string&& key, VariValue val);
+    void __pushKV(const char *key, VariValue val) { __pushKV(std::string_view(key), std::move(val)); }
+    bool pushKV(std::string_view key, std::string val);
+    bool pushKV(std::string&& key, std::string val);
+    bool pushKV(const char *key, std::string val) { return pushKV(std::string_view(key), std::move(val)); }
+    bool pushKV(std::string_view key, const char *val_);
+    bool pushKV(std::string&& key, const char *val_);
+    bool pushKV(const char *key, const char *val_) { return pushKV(std::string_view(key), val_); }
+    bool pushKV(std::string_view key, int64_t val_);
+    bool pushKV(std::string&& key, int64_t val_);
+    bool pushKV(const char *key, int64_t val_) { return pushKV(std::string_view(key), val_); }
+    bool pushKV(std::string_view key, uint64_t val_);
+    bool pushKV(std::string&& key, uint64_t val_);
+    bool pushKV(const char *key, uint64_t val_) { return pushKV(std::string_view(key), val_); }
+    bool pushKV(std::string_view key, bool val_);
+    bool pushKV(std::string&& key, bool val_);
+    bool pushKV(const char *key, bool val_) { return pushKV(std::string_view(key), val_); }
+    bool pushKV(std::string_view key, int val_);
+    bool pushKV(std::string&& key, int val_);
+    bool pushKV(const char *key, int val_) { return pushKV(std::string_view(key), val_); }
+    bool pushKV(std::string_view key, double val_);
+    bool pushKV(std::string&& key, double val_);
+    bool pushKV(const char *key, double val_) { return pushKV(std::string_view(key), val_); }
+    bool pushKV(std::string_view key, std::monostate);
+    bool pushKV(std::string&& key, std::monostate);
+    bool pushKV(const char *key, std::monostate) { return pushKV(std::string_view(key), std::monostate()); }
+    bool pushKV(std::string_view key, VariValue obj);
+    bool pushKV(std::string&& key, VariValue obj);
+    bool pushKV(const char *key, VariValue obj) { return pushKV(std::string_view(key), std::move(obj)); }
     bool pushKVs(VariValue obj);
 
 
@@ -114,6 +324,44 @@ public:
     bool push_back(std::monostate);
     bool push_backV(std::vector<VariValue> vec);
 
+    // In-place edits. References stay valid until the container holding
+    // them is next modified. at() throws std::runtime_error if this is of
+    // the wrong type or the member doesn't exist; find_mut() returns null.
+    // The containers on the way are no longer shared with later copies, so
+    // writing through a reference never changes a copy; see share().
+    VariValue& at(std::string_view key);
+    VariValue& at(size_t index);
+    VariValue *find_mut(std::string_view key);
+    // Remove a member and return its value, null if there was none
+    VariValue take(std::string_view key);
+    // Remove a member or element, keeping the rest in order. Returns
+    // whether there was one.
+    bool erase(std::string_view key);
+    bool erase(size_t index);
+    // Move the contents out, leaving null. Throw std::runtime_error if this
+    // is of the wrong type.
+    std::vector<VariValue> release_array() &&;
+    std::string release_str() &&;
+
+    // Let copies of this value share its containers and strings, down to
+    // the leaves, rather than copy them. A copy then costs O(1), and
+    // changing it copies only the path down to the change. Meant for large
+    // trees that are copied often, like a cached result. Values allocated
+    // from anything but the default resource, such as a VariDocument's
+    // arena, are left as they are. Any non-const access to a container
+    // or string ends its sharing until share() is called again.
+    void share();
+
+    // Views over the contents of an array or object that copy nothing. They
+    // are empty for other types, and stay valid until the value is next
+    // modified.
+    const VariValue *begin() const;
+    const VariValue *end() const;
+    varivalue::Range<const object_t::value_type*> items() const;
+    varivalue::Range<varivalue::KeyIterator> keys() const;
+    // Elements of an array or member values of an object
+    varivalue::Range<varivalue::ValueIterator> values() const;
+
     // Strict type-specific getters, these throw std::runtime_error if the
     // value is of unexpected type
     std::vector<std::string> getKeys() const;
@@ -123,24 +371,121 @@ public:
     int get_int() const;
     int64_t get_int64() const;
     double get_real() const;
+    // The number times 10^decimals, converted exactly from its text. Throws
+    // if the result has a fractional part or doesn't fit an int64_t.
+    int64_t get_fixed(int decimals) const;
+    // Convert every element of an array of numbers into out, in one pass.
+    // The exception for a bad element gives its index.
+    void get_int64_array(std::vector<int64_t>& out) const;
+    void get_real_array(std::vector<double>& out) const;
+    void get_fixed_array(std::vector<int64_t>& out, int decimals) const;
     const VariValue& get_obj() const;
     const VariValue& get_array() const;
 
-    std::string write(unsigned int prettyIndent = 0, unsigned int indentLevel = 0) const;
-    bool read(const char *raw, size_t len);
-    bool read(const char *raw);
-    bool read(const std::string& rawStr);
+    std::string write(unsigned int prettyIndent = 0, unsigned int indentLevel = 0, WriteOrder order = WRITE_INSERTION) const;
+    bool read(const char *raw, size_t len, ReadMode mode = READ_SEQUENTIAL);
+    bool read(const char *raw, ReadMode mode = READ_SEQUENTIAL);
+    bool read(const std::string& rawStr, ReadMode mode = READ_SEQUENTIAL);
+    // Intern object keys into symbols as they are read. A table isn't
+    // shared between threads, so READ_PARALLEL is read as READ_INDEXED,
+    // on the calling thread.
+    bool read(const char *raw, size_t len, VariSymbols& symbols, ReadMode mode = READ_SEQUENTIAL);
+    bool read(const std::string& rawStr, VariSymbols& symbols, ReadMode mode = READ_SEQUENTIAL);
+    // Read a document whose top level is a large array on up to threads
+    // threads (0 for one per cpu). Anything else is read serially.
+    bool readParallel(const char *raw, size_t len, unsigned int threads = 0);
 
     enum VType type() const;
-    friend const VariValue& find_value( const VariValue& obj, const std::string& name);
+    friend const VariValue& find_value(const VariValue& obj, std::string_view name);
+    friend const VariValue& find_value(const VariValue& obj, const VariKey& name);
 
 private:
+    friend class VariValueBuilder;
+    friend class VariTape;
+
     json_t m_value;
+
+    template <typename T, typename Get>
+    void getNumArray(std::vector<T>& out, Get get) const;
 };
 
 extern const VariValue NullUniValue;
 
-const VariValue& find_value( const VariValue& obj, const std::string& name);
+namespace varivalue {
+template <typename It>
+class Range
+{
+public:
+    Range(It begin, It end, size_t size) : m_begin(begin), m_end(end), m_size(size) {}
+
+    It begin() const { return m_begin; }
+    It end() const { return m_end; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+private:
+    It m_begin;
+    It m_end;
+    size_t m_size;
+};
+
+// Walks an object's keys
+class KeyIterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = VariKey;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const VariKey*;
+    using reference = const VariKey&;
+
+    explicit KeyIterator(const object_t::value_type *pos = nullptr) : m_pos(pos) {}
+    reference operator*() const { return m_pos->first; }
+    pointer operator->() const { return &m_pos->first; }
+    KeyIterator& operator++() { ++m_pos; return *this; }
+    KeyIterator operator++(int) { KeyIterator ret = *this; ++m_pos; return ret; }
+    bool operator==(const KeyIterator& other) const { return m_pos == other.m_pos; }
+    bool operator!=(const KeyIterator& other) const { return m_pos != other.m_pos; }
+
+private:
+    const object_t::value_type *m_pos;
+};
+
+// Walks an array's elements or an object's member values
+class ValueIterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = VariValue;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const VariValue*;
+    using reference = const VariValue&;
+
+    ValueIterator() = default;
+    explicit ValueIterator(const VariValue *elem) : m_elem(elem) {}
+    explicit ValueIterator(const object_t::value_type *member) : m_member(member) {}
+    reference operator*() const { return m_member ? m_member->second : *m_elem; }
+    pointer operator->() const { return &**this; }
+    ValueIterator& operator++()
+    {
+        if (m_member)
+            ++m_member;
+        else
+            ++m_elem;
+        return *this;
+    }
+    ValueIterator operator++(int) { ValueIterator ret = *this; ++*this; return ret; }
+    bool operator==(const ValueIterator& other) const { return m_elem == other.m_elem && m_member == other.m_member; }
+    bool operator!=(const ValueIterator& other) const { return !(*this == other); }
+
+private:
+    const VariValue *m_elem{nullptr};
+    const object_t::value_type *m_member{nullptr};
+};
+}
+
+const VariValue& find_value(const VariValue& obj, std::string_view name);
+const VariValue& find_value(const VariValue& obj, const VariKey& name);
 
 static inline constexpr const char *uvTypeName(VariValue::VType t)
 {
@@ -0,0 +1,260 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "varivalue_index.h"
+
+#include <cstring>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VARIVALUE_INDEX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+// Per-byte classification of one 64-byte block, one bit per byte
+struct BlockMasks
+{
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;        // {}[]:,
+    uint64_t space;     // json_isspace()
+    uint64_t unsafe;    // < 0x20 or >= 0x80
+};
+
+void classifyScalar(const unsigned char *in, BlockMasks& m)
+{
+    m = BlockMasks{};
+    for (unsigned int i = 0; i < 64; i++) {
+        const uint64_t bit = uint64_t{1} << i;
+        switch (in[i]) {
+        case '"': m.quote |= bit; break;
+        case '\\': m.backslash |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',': m.op |= bit; break;
+        case ' ': m.space |= bit; break;
+        case '\t': case '\n': case '\r': m.space |= bit; m.unsafe |= bit; break;
+        default:
+            if (in[i] < 0x20 || in[i] >= 0x80)
+                m.unsafe |= bit;
+            break;
+        }
+    }
+}
+
+#ifdef VARIVALUE_INDEX_X86
+__attribute__((target("sse2")))
+inline __m128i eqSSE2(__m128i v, char c)
+{
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+__attribute__((target("sse2")))
+inline uint64_t bitsSSE2(__m128i x)
+{
+    return static_cast<uint16_t>(_mm_movemask_epi8(x));
+}
+
+__attribute__((target("sse2")))
+void classifySSE2(const unsigned char *in, BlockMasks& m)
+{
+    m = BlockMasks{};
+    for (unsigned int i = 0; i < 4; i++) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 16));
+
+        const __m128i op = _mm_or_si128(_mm_or_si128(_mm_or_si128(eqSSE2(v, '{'), eqSSE2(v, '}')),
+                                                     _mm_or_si128(eqSSE2(v, '['), eqSSE2(v, ']'))),
+                                        _mm_or_si128(eqSSE2(v, ':'), eqSSE2(v, ',')));
+        const __m128i space = _mm_or_si128(_mm_or_si128(eqSSE2(v, ' '), eqSSE2(v, '\t')),
+                                           _mm_or_si128(eqSSE2(v, '\n'), eqSSE2(v, '\r')));
+        // Signed compare: catches both control characters and bytes >= 0x80
+        const __m128i unsafe = _mm_cmplt_epi8(v, _mm_set1_epi8(0x20));
+
+        m.quote |= bitsSSE2(eqSSE2(v, '"')) << (i * 16);
+        m.backslash |= bitsSSE2(eqSSE2(v, '\\')) << (i * 16);
+        m.op |= bitsSSE2(op) << (i * 16);
+        m.space |= bitsSSE2(space) << (i * 16);
+        m.unsafe |= bitsSSE2(unsafe) << (i * 16);
+    }
+}
+
+__attribute__((target("avx2")))
+inline __m256i eqAVX2(__m256i v, char c)
+{
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+__attribute__((target("avx2")))
+inline uint64_t bitsAVX2(__m256i x)
+{
+    return static_cast<uint32_t>(_mm256_movemask_epi8(x));
+}
+
+__attribute__((target("avx2")))
+void classifyAVX2(const unsigned char *in, BlockMasks& m)
+{
+    m = BlockMasks{};
+    for (unsigned int i = 0; i < 2; i++) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 32));
+
+        const __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(eqAVX2(v, '{'), eqAVX2(v, '}')),
+                                                           _mm256_or_si256(eqAVX2(v, '['), eqAVX2(v, ']'))),
+                                           _mm256_or_si256(eqAVX2(v, ':'), eqAVX2(v, ',')));
+        const __m256i space = _mm256_or_si256(_mm256_or_si256(eqAVX2(v, ' '), eqAVX2(v, '\t')),
+                                              _mm256_or_si256(eqAVX2(v, '\n'), eqAVX2(v, '\r')));
+        const __m256i unsafe = _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v);
+
+        m.quote |= bitsAVX2(eqAVX2(v, '"')) << (i * 32);
+        m.backslash |= bitsAVX2(eqAVX2(v, '\\')) << (i * 32);
+        m.op |= bitsAVX2(op) << (i * 32);
+        m.space |= bitsAVX2(space) << (i * 32);
+        m.unsafe |= bitsAVX2(unsafe) << (i * 32);
+    }
+}
+#endif
+
+using ClassifyFn = void (*)(const unsigned char *, BlockMasks&);
+
+ClassifyFn selectClassifier(JsonIndexImpl impl)
+{
+    switch (impl) {
+#ifdef VARIVALUE_INDEX_X86
+    case JSONIDX_SSE2: return classifySSE2;
+    case JSONIDX_AVX2: return classifyAVX2;
+#endif
+    case JSONIDX_AUTO: {
+        static const ClassifyFn best = [] {
+            if (jsonIndexImplSupported(JSONIDX_AVX2))
+                return selectClassifier(JSONIDX_AVX2);
+            if (jsonIndexImplSupported(JSONIDX_SSE2))
+                return selectClassifier(JSONIDX_SSE2);
+            return selectClassifier(JSONIDX_SCALAR);
+        }();
+        return best;
+    }
+    default: return classifyScalar;
+    }
+}
+
+// Inclusive prefix xor: bit i of the result is the parity of bits [0, i]
+uint64_t prefixXor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Bits for the characters that are escaped by a backslash. Runs of
+// backslashes are rare, so walking them one at a time is cheap.
+uint64_t findEscaped(uint64_t backslash, bool& carry)
+{
+    uint64_t escaped = carry ? 1 : 0;
+    carry = false;
+    backslash &= ~escaped;
+    while (backslash) {
+        const unsigned int i = __builtin_ctzll(backslash);
+        if (i == 63) {
+            carry = true;
+        } else {
+            escaped |= uint64_t{1} << (i + 1);
+        }
+        backslash &= backslash - 1;
+        backslash &= ~escaped;
+    }
+    return escaped;
+}
+
+} // namespace
+
+bool JsonIndex::anyDirty(size_t begin, size_t end) const
+{
+    if (begin >= end)
+        return false;
+    size_t first = begin / 64;
+    const size_t last = (end - 1) / 64;
+    const uint64_t headMask = ~uint64_t{0} << (begin % 64);
+    const uint64_t tailMask = ~uint64_t{0} >> (63 - (end - 1) % 64);
+    if (first == last)
+        return dirty[first] & headMask & tailMask;
+    if (dirty[first] & headMask)
+        return true;
+    for (++first; first < last; ++first) {
+        if (dirty[first])
+            return true;
+    }
+    return dirty[last] & tailMask;
+}
+
+bool jsonIndexImplSupported(JsonIndexImpl impl)
+{
+    switch (impl) {
+    case JSONIDX_AUTO:
+    case JSONIDX_SCALAR:
+        return true;
+#ifdef VARIVALUE_INDEX_X86
+    case JSONIDX_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case JSONIDX_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+bool buildJsonIndex(JsonIndex& index, const char *raw, size_t len, JsonIndexImpl impl)
+{
+    index.tokens.clear();
+    index.dirty.clear();
+    if (len >= std::numeric_limits<uint32_t>::max() || !jsonIndexImplSupported(impl))
+        return false;
+
+    const ClassifyFn classify = selectClassifier(impl);
+    const unsigned char *in = reinterpret_cast<const unsigned char*>(raw);
+
+    index.dirty.resize((len + 63) / 64);
+    index.tokens.reserve(len / 8);
+
+    bool escapeCarry = false;
+    uint64_t inStringCarry = 0;     // all ones if the previous block ended inside a string
+    uint64_t wordCarry = 0;         // 1 if the previous block ended inside a bare word
+
+    for (size_t base = 0; base < len; base += 64) {
+        BlockMasks m;
+        if (len - base >= 64) {
+            classify(in + base, m);
+        } else {
+            // Pad the tail with whitespace, which never starts a token
+            unsigned char tail[64];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, in + base, len - base);
+            classify(tail, m);
+        }
+
+        const uint64_t escaped = findEscaped(m.backslash, escapeCarry);
+        const uint64_t quote = m.quote & ~escaped;
+
+        // Set from an opening quote up to, but not including, its closing quote
+        const uint64_t inString = prefixXor(quote) ^ inStringCarry;
+        inStringCarry = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+        const uint64_t word = ~(m.op | m.space | quote | inString);
+        const uint64_t wordStart = word & ~((word << 1) | wordCarry);
+        wordCarry = word >> 63;
+
+        uint64_t tokens = (m.op & ~inString) | quote | wordStart;
+        while (tokens) {
+            index.tokens.push_back(static_cast<uint32_t>(base + __builtin_ctzll(tokens)));
+            tokens &= tokens - 1;
+        }
+
+        index.dirty[base / 64] = m.unsafe | m.backslash;
+    }
+    return true;
+}
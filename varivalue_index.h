@@ -0,0 +1,49 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIVALUE_INDEX_H__
+#define __VARIVALUE_INDEX_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Structural index of a JSON document, produced by a vectorized first pass
+ * over the input.
+ *
+ * tokens holds the offset of every token start outside of strings: the
+ * structural characters {}[]:, both quotes of every string, and the first
+ * byte of every bare word (numbers, literals and garbage alike). dirty is a
+ * bitmap with one bit per input byte, set for bytes that a string body can
+ * not be copied verbatim over: backslashes, control characters and
+ * non-ASCII bytes.
+ *
+ * The index is only a hint. Offsets are never trusted without the second
+ * pass re-checking the bytes they point to.
+ */
+struct JsonIndex
+{
+    std::vector<uint32_t> tokens;
+    std::vector<uint64_t> dirty;
+
+    // True if any byte in [begin, end) is marked dirty
+    bool anyDirty(size_t begin, size_t end) const;
+};
+
+enum JsonIndexImpl {
+    JSONIDX_AUTO,
+    JSONIDX_SCALAR,
+    JSONIDX_SSE2,
+    JSONIDX_AVX2,
+};
+
+// Whether the running cpu can execute the given implementation
+bool jsonIndexImplSupported(JsonIndexImpl impl);
+
+// Build the index for [raw, raw + len). Inputs of 4GiB or more are not
+// indexable, in which case false is returned and index is left empty.
+bool buildJsonIndex(JsonIndex& index, const char *raw, size_t len, JsonIndexImpl impl = JSONIDX_AUTO);
+
+#endif // __VARIVALUE_INDEX_H__
@@ -0,0 +1,112 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "varivalue_ndjson.h"
+#include "varivalue_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <thread>
+
+namespace {
+
+// Smallest piece of input handed to a worker at once
+static constexpr size_t MIN_CHUNK = 64 * 1024;
+
+// Results for one run of whole lines, with line numbers and record
+// indices relative to its start
+struct Chunk
+{
+    const char *begin;
+    const char *end;
+    size_t lines{0};
+    std::vector<VariValue> values;
+    std::vector<NdjsonError> errors;
+};
+
+void parseChunk(Chunk& chunk, const char *base)
+{
+    const char *line = chunk.begin;
+    while (line < chunk.end) {
+        const char *eol = static_cast<const char*>(memchr(line, '\n', chunk.end - line));
+        if (!eol)
+            eol = chunk.end;
+        chunk.lines++;
+
+        const char *p = line;
+        while (p < eol && json_isspace(*p))
+            p++;
+        if (p < eol) {
+            VariValue& val = chunk.values.emplace_back();
+            if (!val.read(line, eol - line)) {
+                val.clear();
+                chunk.errors.push_back({chunk.lines, size_t(line - base), chunk.values.size() - 1});
+            }
+        }
+        line = eol + 1;
+    }
+}
+
+} // namespace
+
+bool readNdjson(std::vector<VariValue>& values, std::vector<NdjsonError>& errors,
+                const char *raw, size_t len, unsigned int threads)
+{
+    values.clear();
+    errors.clear();
+    if (threads == 0)
+        threads = std::max(1U, std::thread::hardware_concurrency());
+
+    // Several chunks per thread, so that one with slow records doesn't hold
+    // up the whole batch
+    const size_t target = std::max(MIN_CHUNK, len / (threads * 8) + 1);
+    std::vector<Chunk> chunks;
+    const char *end = raw + len;
+    for (const char *begin = raw; begin < end;) {
+        const char *stop = begin + std::min(target, size_t(end - begin));
+        const char *eol = static_cast<const char*>(memchr(stop - 1, '\n', end - stop + 1));
+        stop = eol ? eol + 1 : end;
+        Chunk& chunk = chunks.emplace_back();
+        chunk.begin = begin;
+        chunk.end = stop;
+        begin = stop;
+    }
+
+    threads = std::min<size_t>(threads, chunks.size());
+    if (threads <= 1) {
+        for (Chunk& chunk : chunks)
+            parseChunk(chunk, raw);
+    } else {
+        std::atomic<size_t> next{0};
+        auto work = [&] {
+            for (size_t i = next++; i < chunks.size(); i = next++)
+                parseChunk(chunks[i], raw);
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < threads; i++)
+            workers.emplace_back(work);
+        work();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    size_t total = 0;
+    for (const Chunk& chunk : chunks)
+        total += chunk.values.size();
+    values.reserve(total);
+
+    size_t lines = 0;
+    for (Chunk& chunk : chunks) {
+        for (NdjsonError err : chunk.errors) {
+            err.line += lines;
+            err.record += values.size();
+            errors.push_back(err);
+        }
+        std::move(chunk.values.begin(), chunk.values.end(), std::back_inserter(values));
+        lines += chunk.lines;
+    }
+    return errors.empty();
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIVALUE_NDJSON_H__
+#define __VARIVALUE_NDJSON_H__
+
+#include "varivalue.h"
+
+#include <cstddef>
+#include <vector>
+
+struct NdjsonError
+{
+    size_t line;    // 1-based line number
+    size_t offset;  // of the start of the line
+    size_t record;  // index of the line's entry in values
+};
+
+/**
+ * Read newline-delimited JSON: one document per line, blank lines ignored.
+ * JSON text can't contain a raw newline, so records are found without
+ * parsing and the buffer is split between threads worker threads (0 for
+ * one per cpu).
+ *
+ * values gets one entry per non-blank line, in input order. A line that
+ * fails to parse leaves a null entry and is listed in errors, without
+ * affecting the rest. Returns true if every line parsed.
+ */
+bool readNdjson(std::vector<VariValue>& values, std::vector<NdjsonError>& errors,
+                const char *raw, size_t len, unsigned int threads = 0);
+
+#endif // __VARIVALUE_NDJSON_H__
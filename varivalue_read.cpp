@@ -6,294 +6,285 @@
 #include <string.h>
 #include <vector>
 #include <stdio.h>
+#include <algorithm>
+#include <iterator>
+#include <thread>
 #include "varivalue.h"
 #include "varivalue_util.h"
+#include "variparser.h"
+#include "varivalue_sax.h"
+#include "varivalue_index.h"
 
-/*
- * According to stackexchange, the original json test suite wanted
- * to limit depth to 22.  Widely-deployed PHP bails at depth 512,
- * so we will follow PHP's lead, which should be more than sufficient
- * (further stackexchange comments indicate depth > 32 rarely occurs).
- */
-static constexpr size_t MAX_JSON_DEPTH = 512;
-
-enum expect_bits {
-    EXP_OBJ_NAME = (1U << 0),
-    EXP_COLON = (1U << 1),
-    EXP_ARR_VALUE = (1U << 2),
-    EXP_VALUE = (1U << 3),
-    EXP_NOT_VALUE = (1U << 4),
-};
-
-#define expect(bit) (expectMask & (EXP_##bit))
-#define setExpect(bit) (expectMask |= EXP_##bit)
-#define clearExpect(bit) (expectMask &= ~EXP_##bit)
+namespace {
 
-bool VariValue::read(const char *raw, size_t size)
+// Tokenizes the input front to back with getJsonToken
+class ScanTokenSource
 {
-    clear();
-
-    uint32_t expectMask = 0;
-    std::vector<UniValue*> stack;
-
-    std::string tokenVal;
-    unsigned int consumed;
-    enum jtokentype tok = JTOK_NONE;
-    enum jtokentype last_tok = JTOK_NONE;
-    const char* end = raw + size;
-
-
-    std::string cur_key;
-    bool have_key{false};
-    do {
-        last_tok = tok;
-
-        tok = getJsonToken(tokenVal, consumed, raw, end);
-        if (tok == JTOK_NONE || tok == JTOK_ERR)
-            return false;
-        raw += consumed;
-
-        bool isValueOpen = jsonTokenIsValue(tok) ||
-            tok == JTOK_OBJ_OPEN || tok == JTOK_ARR_OPEN;
-
-        if (expect(VALUE)) {
-            if (!isValueOpen)
-                return false;
-            clearExpect(VALUE);
-
-        } else if (expect(ARR_VALUE)) {
-            bool isArrValue = isValueOpen || (tok == JTOK_ARR_CLOSE);
-            if (!isArrValue)
-                return false;
-
-            clearExpect(ARR_VALUE);
-
-        } else if (expect(OBJ_NAME)) {
-            bool isObjName = (tok == JTOK_OBJ_CLOSE || tok == JTOK_STRING);
-            if (!isObjName)
-                return false;
-
-        } else if (expect(COLON)) {
-            if (tok != JTOK_COLON)
-                return false;
-            clearExpect(COLON);
+public:
+    ScanTokenSource(const char *raw, const char *end, std::string& scratch)
+        : m_raw(raw), m_end(end), m_scratch(scratch) {}
+
+    jtokentype next(std::string_view& tokenVal)
+    {
+        unsigned int consumed;
+        jtokentype tok = getJsonToken(tokenVal, m_scratch, consumed, m_raw, m_end);
+        m_raw += consumed;
+        return tok;
+    }
+
+private:
+    const char *m_raw;
+    const char *m_end;
+    std::string& m_scratch;
+};
 
-        } else if (!expect(COLON) && (tok == JTOK_COLON)) {
-            return false;
+// Walks the token starts recorded by buildJsonIndex. Escape-free ASCII
+// strings are sliced out of the input in one go, everything else is handed to getJsonToken
+// at the indexed offset so that validation stays identical to the scan. If
+// the index and the input disagree about where the next token starts, fall
+// back to scanning from the current position.
+class IndexedTokenSource
+{
+public:
+    IndexedTokenSource(const JsonIndex& index, const char *raw, const char *end, std::string& scratch)
+        : m_index(index), m_begin(raw), m_raw(raw), m_end(end), m_scratch(scratch) {}
+
+    // Walk [raw, end), a part of the input that was indexed from begin
+    IndexedTokenSource(const JsonIndex& index, const char *begin, const char *raw, const char *end, std::string& scratch)
+        : m_index(index), m_begin(begin), m_raw(raw), m_end(end), m_scratch(scratch)
+    {
+        m_next = std::lower_bound(index.tokens.begin(), index.tokens.end(), uint32_t(raw - begin)) - index.tokens.begin();
+    }
+
+    jtokentype next(std::string_view& tokenVal)
+    {
+        const std::vector<uint32_t>& tokens = m_index.tokens;
+        const char *tok = nullptr;
+        if (m_next < tokens.size() && tokens[m_next] < size_t(m_end - m_begin)) {
+            const char *hint = m_begin + tokens[m_next];
+            const char *p = m_raw;
+            while (p < hint && json_isspace(*p))
+                p++;
+            if (p == hint)
+                tok = hint;
         }
 
-        if (expect(NOT_VALUE)) {
-            if (isValueOpen)
-                return false;
-            clearExpect(NOT_VALUE);
+        if (!tok) {
+            unsigned int consumed;
+            jtokentype ret = getJsonToken(tokenVal, m_scratch, consumed, m_raw, m_end);
+            advance(m_raw + consumed);
+            return ret;
         }
-
-        switch (tok) {
-
-        case JTOK_OBJ_OPEN:
-        case JTOK_ARR_OPEN: {
-            VType utyp = (tok == JTOK_OBJ_OPEN ? VOBJ : VARR);
-            if (!stack.size()) {
-                if (utyp == VOBJ)
-                    setObject();
-                else
-                    setArray();
-                stack.push_back(this);
-            } else {
-                UniValue* top = stack.back();
-                UniValue tmpVal(utyp);
-                std::visit(varivalue::overloaded {
-                    [&](array_t& arr) {
-                        auto& newTop = arr.emplace_back(std::move(tmpVal));
-                        stack.push_back(&newTop);
-                    },
-                    [&](object_t& obj) {
-                        const auto& [iter, inserted] = obj.emplace(std::move(cur_key), std::move(tmpVal));
-                        have_key = false;
-                        cur_key.clear();
-                        stack.push_back(&iter->second);
-                    },
-                    [&](const auto&) {},
-                }, top->m_value);
-            }
-
-            if (stack.size() > MAX_JSON_DEPTH)
-                return false;
-
-            if (utyp == VOBJ)
-                setExpect(OBJ_NAME);
-            else
-                setExpect(ARR_VALUE);
-            break;
+        m_next++;
+
+        if (*tok == '"' && m_next < tokens.size() && tokens[m_next] < size_t(m_end - m_begin)) {
+            const char *close = m_begin + tokens[m_next];
+            if (*close == '"' && !m_index.anyDirty(tok + 1 - m_begin, close - m_begin)) {
+                tokenVal = std::string_view(tok + 1, close - tok - 1);
+                advance(close + 1);
+                return JTOK_STRING;
             }
+        }
 
-        case JTOK_OBJ_CLOSE:
-        case JTOK_ARR_CLOSE: {
-            if (!stack.size() || (last_tok == JTOK_COMMA))
-                return false;
+        unsigned int consumed;
+        jtokentype ret = getJsonToken(tokenVal, m_scratch, consumed, tok, m_end);
+        advance(tok + consumed);
+        return ret;
+    }
+
+private:
+    const JsonIndex& m_index;
+    const char *m_begin;
+    const char *m_raw;
+    const char *m_end;
+    size_t m_next{0};
+    std::string& m_scratch;
+
+    void advance(const char *raw)
+    {
+        m_raw = raw;
+        while (m_next < m_index.tokens.size() && m_begin + m_index.tokens[m_next] < m_raw)
+            m_next++;
+    }
+};
 
-            VType utyp = (tok == JTOK_OBJ_CLOSE ? VOBJ : VARR);
-            UniValue *top = stack.back();
-            if (utyp != top->getType())
-                return false;
+template <typename TokenSource>
+bool readTokens(SaxReader<VariValueBuilder>& reader, TokenSource& src)
+{
+    std::string_view tokenVal;
+    do {
+        if (!reader.token(src.next(tokenVal), tokenVal))
+            return false;
+    } while (!reader.done());
 
-            stack.pop_back();
-            clearExpect(OBJ_NAME);
-            setExpect(NOT_VALUE);
-            break;
-            }
+    /* Check that nothing follows the initial construct (parsed above).  */
+    return src.next(tokenVal) == JTOK_NONE;
+}
 
-        case JTOK_COLON: {
-            if (!stack.size())
-                return false;
+// Read [raw, end), a run of elements of a top-level array, into arr. The
+// first slice includes the opening bracket and the last one the closing
+// bracket and whatever follows; for the others the brackets are made up.
+// Requiring at least one element keeps empty slots like [1,,2] invalid.
+bool readSlice(VariValue& arr, const JsonIndex& index, const char *begin, const char *raw, const char *end, bool first, bool last)
+{
+    VariValueBuilder builder(arr);
+    SaxReader<VariValueBuilder> reader(builder);
+    if (!first && !reader.token(JTOK_ARR_OPEN, {}))
+        return false;
 
-            UniValue *top = stack.back();
-            if (top->getType() != VOBJ)
-                return false;
+    std::string scratch;
+    IndexedTokenSource src(index, begin, raw, end, scratch);
+    std::string_view tokenVal;
+    for (jtokentype tok = src.next(tokenVal); tok != JTOK_NONE; tok = src.next(tokenVal)) {
+        if (!reader.token(tok, tokenVal))
+            return false;
+    }
+    if (!last && !reader.token(JTOK_ARR_CLOSE, {}))
+        return false;
+    return reader.done() && !arr.empty();
+}
 
-            setExpect(VALUE);
-            break;
-            }
+// Each thread keeps a parser around, so that repeated reads don't allocate
+// its stacks and buffers over again
+VariParser& threadParser()
+{
+    thread_local VariParser parser;
+    return parser;
+}
 
-        case JTOK_COMMA: {
-            if (!stack.size() ||
-                (last_tok == JTOK_COMMA) || (last_tok == JTOK_ARR_OPEN))
-                return false;
+// Interns keys into symbols while in scope. Since the parser is reused by
+// later reads on the thread, the table is dropped again even if a read throws.
+class InternScope
+{
+public:
+    InternScope(VariParser& parser, VariSymbols& symbols) : m_parser(parser) { m_parser.internKeys(&symbols); }
+    ~InternScope() { m_parser.internKeys(nullptr); }
+    InternScope(const InternScope&) = delete;
+    InternScope& operator=(const InternScope&) = delete;
+
+private:
+    VariParser& m_parser;
+};
 
-            UniValue *top = stack.back();
-            if (top->getType() == VOBJ)
-                setExpect(OBJ_NAME);
-            else
-                setExpect(ARR_VALUE);
-            break;
-            }
+} // namespace
 
-        case JTOK_KW_NULL: {
-            if (!stack.size()) {
-                m_value = std::monostate();
-                break;
-            }
-            UniValue* top = stack.back();
-            UniValue tmpVal;
-            std::visit(varivalue::overloaded {
-                [&](array_t& arr) {
-                    arr.emplace_back(std::move(tmpVal));
-                },
-                [&](object_t& obj) {
-                    obj.emplace(std::move(cur_key), std::move(tmpVal));
-                    have_key = false;
-                    cur_key.clear();
-                    },
-                [&](const auto&) {},
-            }, top->m_value);
+// Split a top-level array at depth-1 commas near evenly spaced guesses and
+// parse the pieces concurrently. The index doesn't know about nesting, so
+// brackets are counted to find the commas. Should the index be wrong, a
+// slice that doesn't start on an element boundary can't parse as a list of
+// elements, and any failure means falling back to the serial reader.
+bool VariValue::readParallel(const char *raw, size_t size, unsigned int threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+
+    size_t start = 0;
+    while (start < size && json_isspace(raw[start]))
+        start++;
+    const size_t pieces = std::min<size_t>(threads, size / PARALLEL_MIN_SLICE);
+    JsonIndex index;
+    if (start == size || raw[start] != '[' || pieces < 2 || !buildJsonIndex(index, raw, size))
+        return read(raw, size);
+
+    std::vector<size_t> commas;
+    size_t depth = 0;
+    for (uint32_t pos : index.tokens) {
+        switch (raw[pos]) {
+        case '[': case '{': depth++; break;
+        case ']': case '}': depth--; break;
+        case ',':
+            if (depth == 1 && pos >= (commas.size() + 1) * size / pieces)
+                commas.push_back(pos);
             break;
-            }
-        case JTOK_KW_TRUE:
-        case JTOK_KW_FALSE: {
-            bool val;
-            switch (tok) {
-            case JTOK_KW_TRUE:
-                val = true;
-                break;
-            case JTOK_KW_FALSE:
-                val = false;
-                break;
-            default: /* impossible */ break;
-            }
-
-            if (!stack.size()) {
-                m_value = val;
-                break;
-            }
-            UniValue tmpVal(val);
-            UniValue* top = stack.back();
-            std::visit(varivalue::overloaded {
-                [&](array_t& arr) {
-                    arr.push_back(std::move(tmpVal));
-                },
-                [&](object_t& obj) {
-                    obj.emplace(std::move(cur_key), std::move(tmpVal));
-                    have_key = false;
-                    cur_key.clear();
-                },
-                [&](const auto&) {},
-            }, top->m_value);
-
-            setExpect(NOT_VALUE);
+        }
+        if (commas.size() == pieces - 1 || depth == 0)
             break;
-            }
+    }
+    if (commas.empty())
+        return read(raw, size);
+
+    std::vector<VariValue> parts(commas.size() + 1);
+    std::vector<char> ok(parts.size());
+    auto work = [&](size_t i) {
+        const char *first = i == 0 ? raw : raw + commas[i - 1] + 1;
+        const char *last = i == commas.size() ? raw + size : raw + commas[i];
+        ok[i] = readSlice(parts[i], index, raw, first, last, i == 0, i == commas.size());
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < parts.size(); i++)
+        workers.emplace_back(work, i);
+    work(0);
+    for (std::thread& worker : workers)
+        worker.join();
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end())
+        return read(raw, size);
+
+    size_t total = 0;
+    for (const VariValue& part : parts)
+        total += part.size();
+    *this = std::move(parts[0]);
+    array_t& arr = *std::get<varivalue::Box<array_t>>(m_value);
+    arr.reserve(total);
+    for (size_t i = 1; i < parts.size(); i++) {
+        array_t& part = *std::get<varivalue::Box<array_t>>(parts[i].m_value);
+        arr.insert(arr.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+    return true;
+}
 
-        case JTOK_NUMBER: {
-            if (!stack.size()) {
-                setNumStr(std::move(tokenVal));
-                break;
-            }
-            VariValue tmpVal(VNUM, std::move(tokenVal));
-            UniValue *top = stack.back();
-            std::visit(varivalue::overloaded {
-                [&](array_t& arr) {
-                    arr.emplace_back(std::move(tmpVal));
-                },
-                [&](object_t& obj) {
-                    const auto& [iter, inserted] = obj.emplace(std::move(cur_key), std::move(tmpVal));
-                    have_key = false;
-                    cur_key.clear();
-                },
-                [&](const auto&) {},
-            }, top->m_value);
-
-            setExpect(NOT_VALUE);
-            break;
-            }
+bool VariParser::read(VariValue& val, const char *raw, size_t len, VariValue::ReadMode mode)
+{
+    if (mode == VariValue::READ_PARALLEL)
+        return val.readParallel(raw, len);
+
+    // Free the old tree first, so that a pool can hand its memory to the new one
+    val.clear();
+    reset();
+    bool ok;
+    if (mode == VariValue::READ_INDEXED && buildJsonIndex(m_index, raw, len)) {
+        IndexedTokenSource src(m_index, raw, raw + len, m_scratch);
+        ok = readTokens(m_reader, src);
+    } else {
+        ScanTokenSource src(raw, raw + len, m_scratch);
+        ok = readTokens(m_reader, src);
+    }
+    val = std::move(m_root);
+    reset();
+
+    // Don't let one huge document pin its buffers for the parser's lifetime
+    if (m_index.tokens.capacity() * sizeof(uint32_t) + m_index.dirty.capacity() * sizeof(uint64_t) > KEEP_MAX)
+        m_index = JsonIndex();
+    if (m_scratch.capacity() > KEEP_MAX)
+        std::string().swap(m_scratch);
+    return ok;
+}
 
-        case JTOK_STRING: {
-            if (expect(OBJ_NAME)) {
-                cur_key = std::move(tokenVal);
-                have_key = true;
-                clearExpect(OBJ_NAME);
-                setExpect(COLON);
-            } else {
-                if (!stack.size()) {
-                    m_value = std::move(tokenVal);
-                    break;
-                }
-                UniValue tmpVal(std::move(tokenVal));
-                UniValue *top = stack.back();
-                std::visit(varivalue::overloaded {
-                    [&](array_t& arr) {
-                        arr.emplace_back(std::move(tmpVal));
-                    },
-                    [&](object_t& obj) {
-                        obj.emplace(std::move(cur_key), std::move(tmpVal));
-                        have_key = false;
-                        cur_key.clear();
-                    },
-                    [&](const auto&) {},
-                }, top->m_value);
-            }
-            setExpect(NOT_VALUE);
-            break;
-            }
+bool VariValue::read(const char *raw, size_t size, ReadMode mode)
+{
+    if (mode == READ_PARALLEL)
+        return readParallel(raw, size);
 
-        default:
-            return false;
-        }
-    } while (!stack.empty ());
+    return threadParser().read(*this, raw, size, mode);
+}
 
-    /* Check that nothing follows the initial construct (parsed above).  */
-    tok = getJsonToken(tokenVal, consumed, raw, end);
-    if (tok != JTOK_NONE)
-        return false;
+bool VariValue::read(const char *raw, size_t size, VariSymbols& symbols, ReadMode mode)
+{
+    VariParser& parser = threadParser();
+    const InternScope scope(parser, symbols);
+    return parser.read(*this, raw, size, mode == READ_PARALLEL ? READ_INDEXED : mode);
+}
 
-    return true;
+bool VariValue::read(const std::string& rawStr, VariSymbols& symbols, ReadMode mode)
+{
+    return read(rawStr.data(), rawStr.size(), symbols, mode);
 }
 
-bool VariValue::read(const char *raw)
+bool VariValue::read(const char *raw, ReadMode mode)
 {
-    return read(raw, strlen(raw));
+    return read(raw, strlen(raw), mode);
 }
 
-bool VariValue::read(const std::string& rawStr)
+bool VariValue::read(const std::string& rawStr, ReadMode mode)
 {
-    return read(rawStr.data(), rawStr.size());
+    return read(rawStr.data(), rawStr.size(), mode);
 }
@@ -0,0 +1,268 @@
+// Copyright 2014 BitPay Inc.
+// Copyright 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIVALUE_SAX_H__
+#define __VARIVALUE_SAX_H__
+
+#include "varivalue_util.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * According to stackexchange, the original json test suite wanted
+ * to limit depth to 22.  Widely-deployed PHP bails at depth 512,
+ * so we will follow PHP's lead, which should be more than sufficient
+ * (further stackexchange comments indicate depth > 32 rarely occurs).
+ */
+static constexpr size_t MAX_JSON_DEPTH = 512;
+
+/**
+ * Checks a stream of tokens against the JSON grammar and reports the
+ * document to a handler as a sequence of events. This is the one place the
+ * grammar is enforced: VariValue::read() and VariParser build their trees
+ * with a handler too.
+ *
+ * Keys aren't tracked, so every member of an object is reported, repeated
+ * keys included, and it is up to the handler to merge or reject them.
+ * VariValueBuilder keeps the first value of a repeated key and fails if a
+ * later object or array can't be merged into it, so read() rejects some
+ * documents that the grammar alone allows.
+ *
+ * Handler must provide the following, each returning false to abort:
+ *
+ *     bool on_null();
+ *     bool on_bool(bool val);
+ *     bool on_number(std::string_view val);   // validated number text
+ *     bool on_string(std::string_view val);   // decoded string value
+ *     bool on_key(std::string_view key);      // decoded object key
+ *     bool on_object_begin();
+ *     bool on_object_end();
+ *     bool on_array_begin();
+ *     bool on_array_end();
+ *
+ * Views passed to a handler are only valid for the duration of the call.
+ * Handlers are called directly, so they are inlined where possible.
+ */
+template <typename Handler>
+class SaxReader
+{
+public:
+    explicit SaxReader(Handler& handler) : m_handler(handler) {}
+
+    // Feed the next token. Returns false if the document is invalid or the
+    // handler aborted, after which all further calls fail too.
+    bool token(jtokentype tok, std::string_view tokenVal);
+
+    // Whether a complete top-level value has been read
+    bool done() const { return m_done; }
+
+    void reset()
+    {
+        m_stack.clear();
+        m_expectMask = 0;
+        m_lastTok = JTOK_NONE;
+        m_done = false;
+        m_failed = false;
+    }
+
+private:
+    enum expect_bits {
+        EXP_OBJ_NAME = (1U << 0),
+        EXP_COLON = (1U << 1),
+        EXP_ARR_VALUE = (1U << 2),
+        EXP_VALUE = (1U << 3),
+        EXP_NOT_VALUE = (1U << 4),
+    };
+
+    Handler& m_handler;
+    std::vector<bool> m_stack; // open containers, true for objects
+    uint32_t m_expectMask{0};
+    jtokentype m_lastTok{JTOK_NONE};
+    bool m_done{false};
+    bool m_failed{false};
+
+    bool fail() { m_failed = true; return false; }
+};
+
+#define expect(bit) (m_expectMask & (EXP_##bit))
+#define setExpect(bit) (m_expectMask |= EXP_##bit)
+#define clearExpect(bit) (m_expectMask &= ~EXP_##bit)
+
+template <typename Handler>
+bool SaxReader<Handler>::token(jtokentype tok, std::string_view tokenVal)
+{
+    if (m_failed || m_done || tok == JTOK_NONE || tok == JTOK_ERR)
+        return fail();
+
+    bool isValueOpen = jsonTokenIsValue(tok) ||
+        tok == JTOK_OBJ_OPEN || tok == JTOK_ARR_OPEN;
+
+    if (expect(VALUE)) {
+        if (!isValueOpen)
+            return fail();
+        clearExpect(VALUE);
+
+    } else if (expect(ARR_VALUE)) {
+        bool isArrValue = isValueOpen || (tok == JTOK_ARR_CLOSE);
+        if (!isArrValue)
+            return fail();
+
+        clearExpect(ARR_VALUE);
+
+    } else if (expect(OBJ_NAME)) {
+        bool isObjName = (tok == JTOK_OBJ_CLOSE || tok == JTOK_STRING);
+        if (!isObjName)
+            return fail();
+
+    } else if (expect(COLON)) {
+        if (tok != JTOK_COLON)
+            return fail();
+        clearExpect(COLON);
+
+    } else if (!expect(COLON) && (tok == JTOK_COLON)) {
+        return fail();
+    }
+
+    if (expect(NOT_VALUE)) {
+        if (isValueOpen)
+            return fail();
+        clearExpect(NOT_VALUE);
+    }
+
+    switch (tok) {
+
+    case JTOK_OBJ_OPEN:
+    case JTOK_ARR_OPEN: {
+        bool isObj = (tok == JTOK_OBJ_OPEN);
+        if (!(isObj ? m_handler.on_object_begin() : m_handler.on_array_begin()))
+            return fail();
+        m_stack.push_back(isObj);
+
+        if (m_stack.size() > MAX_JSON_DEPTH)
+            return fail();
+
+        if (isObj)
+            setExpect(OBJ_NAME);
+        else
+            setExpect(ARR_VALUE);
+        break;
+        }
+
+    case JTOK_OBJ_CLOSE:
+    case JTOK_ARR_CLOSE: {
+        if (!m_stack.size() || (m_lastTok == JTOK_COMMA))
+            return fail();
+
+        bool isObj = (tok == JTOK_OBJ_CLOSE);
+        if (isObj != m_stack.back())
+            return fail();
+
+        m_stack.pop_back();
+        if (!(isObj ? m_handler.on_object_end() : m_handler.on_array_end()))
+            return fail();
+        clearExpect(OBJ_NAME);
+        setExpect(NOT_VALUE);
+        break;
+        }
+
+    case JTOK_COLON: {
+        if (!m_stack.size() || !m_stack.back())
+            return fail();
+
+        setExpect(VALUE);
+        break;
+        }
+
+    case JTOK_COMMA: {
+        if (!m_stack.size() ||
+            (m_lastTok == JTOK_COMMA) || (m_lastTok == JTOK_ARR_OPEN))
+            return fail();
+
+        if (m_stack.back())
+            setExpect(OBJ_NAME);
+        else
+            setExpect(ARR_VALUE);
+        break;
+        }
+
+    case JTOK_KW_NULL: {
+        if (!m_handler.on_null())
+            return fail();
+        break;
+        }
+
+    case JTOK_KW_TRUE:
+    case JTOK_KW_FALSE: {
+        if (!m_handler.on_bool(tok == JTOK_KW_TRUE))
+            return fail();
+        setExpect(NOT_VALUE);
+        break;
+        }
+
+    case JTOK_NUMBER: {
+        if (!m_handler.on_number(tokenVal))
+            return fail();
+        setExpect(NOT_VALUE);
+        break;
+        }
+
+    case JTOK_STRING: {
+        if (expect(OBJ_NAME)) {
+            if (!m_handler.on_key(tokenVal))
+                return fail();
+            clearExpect(OBJ_NAME);
+            setExpect(COLON);
+        } else {
+            if (!m_handler.on_string(tokenVal))
+                return fail();
+        }
+        setExpect(NOT_VALUE);
+        break;
+        }
+
+    default:
+        return fail();
+    }
+
+    m_lastTok = tok;
+    if (m_stack.empty())
+        m_done = true;
+    return true;
+}
+
+#undef expect
+#undef setExpect
+#undef clearExpect
+
+/**
+ * Parse [raw, raw + len) and report it to handler. Returns true if the input
+ * is a single valid JSON value and the handler did not abort. That is what
+ * VariValue::read() accepts, except that repeated keys are left to the
+ * handler, see SaxReader.
+ */
+template <typename Handler>
+bool readSax(Handler& handler, const char *raw, size_t len)
+{
+    SaxReader<Handler> reader(handler);
+    const char *end = raw + len;
+    std::string_view tokenVal;
+    std::string scratch;
+    unsigned int consumed;
+    do {
+        jtokentype tok = getJsonToken(tokenVal, scratch, consumed, raw, end);
+        if (!reader.token(tok, tokenVal))
+            return false;
+        raw += consumed;
+    } while (!reader.done());
+
+    /* Check that nothing follows the initial construct (parsed above).  */
+    return getJsonToken(tokenVal, scratch, consumed, raw, end) == JTOK_NONE;
+}
+
+#endif // __VARIVALUE_SAX_H__
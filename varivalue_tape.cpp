@@ -0,0 +1,437 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "varivalue_tape.h"
+#include "variparser.h"
+#include "varivalue_sax.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+uint64_t entry(VariTape::Tag tag, uint64_t payload = 0)
+{
+    return (uint64_t{tag} << 56) | payload;
+}
+
+// Entries followed by a length entry
+bool hasText(VariTape::Tag tag)
+{
+    return tag == VariTape::TAG_STRING || tag == VariTape::TAG_KEY || tag == VariTape::TAG_NUMBER;
+}
+
+void appendText(std::vector<uint64_t>& tape, std::string& strings, VariTape::Tag tag, std::string_view val)
+{
+    tape.push_back(entry(tag, strings.size()));
+    tape.push_back(val.size());
+    strings.append(val);
+}
+
+// Finish the container opened at tape[open]. Fails if the index past its
+// end doesn't fit the begin entry.
+bool close(std::vector<uint64_t>& tape, size_t open, uint64_t count, VariTape::Tag tag)
+{
+    tape.push_back(entry(tag, open));
+    if (tape.size() > VariTape::INDEX_MAX)
+        return false;
+    tape[open] |= std::min(count, VariTape::COUNT_MAX) << 32 | tape.size();
+    return true;
+}
+
+} // namespace
+
+// SaxReader handler that appends to a tape
+class TapeBuilder
+{
+public:
+    explicit TapeBuilder(VariTape& tape) : m_owner(tape), m_tape(tape.m_tape), m_strings(tape.m_strings) {}
+
+    bool on_null() { value(); m_tape.push_back(entry(VariTape::TAG_NULL)); return true; }
+    bool on_bool(bool val) { value(); m_tape.push_back(entry(val ? VariTape::TAG_TRUE : VariTape::TAG_FALSE)); return true; }
+    bool on_number(std::string_view val) { value(); text(VariTape::TAG_NUMBER, val); return true; }
+    bool on_string(std::string_view val) { value(); text(VariTape::TAG_STRING, val); return true; }
+    bool on_key(std::string_view key)
+    {
+        Open& open = m_open.back();
+        if (!open.repeated)
+            open.repeated = !addKey(open, key);
+        m_keys.push_back(m_tape.size());
+        text(VariTape::TAG_KEY, key);
+        return true;
+    }
+    bool on_object_begin() { return begin(VariTape::TAG_OBJ_BEGIN); }
+    bool on_object_end() { return end(VariTape::TAG_OBJ_END); }
+    bool on_array_begin() { return begin(VariTape::TAG_ARR_BEGIN); }
+    bool on_array_end() { return end(VariTape::TAG_ARR_END); }
+
+private:
+    // Objects up to this size are checked for repeated keys by comparing
+    // each new key with the ones before, larger ones through a hash table
+    static constexpr size_t PAIRWISE_MAX = 16;
+
+    struct Open
+    {
+        size_t idx;
+        uint64_t count;
+        // Where the object's keys start in m_keys
+        size_t keys;
+        bool repeated;
+        // Whether it uses the last table in use in m_tables
+        bool table;
+    };
+
+    // Open-addressing table slot: the top half of a key's hash and 1 + its
+    // position in m_keys, 0 if free
+    struct Slot
+    {
+        uint32_t hash;
+        uint32_t pos;
+    };
+
+    VariTape& m_owner;
+    std::vector<uint64_t>& m_tape;
+    std::string& m_strings;
+    std::vector<Open> m_open;
+    // Tape index of each key of the open objects
+    std::vector<size_t> m_keys;
+    // Key tables of the large open objects, innermost last. Kept for the
+    // next large objects once they close, along with their capacity.
+    std::vector<std::vector<Slot>> m_tables;
+    size_t m_tablesUsed{0};
+    std::vector<Slot> m_rehash;
+
+    void value()
+    {
+        if (!m_open.empty())
+            m_open.back().count++;
+    }
+
+    void text(VariTape::Tag tag, std::string_view val) { appendText(m_tape, m_strings, tag, val); }
+
+    bool begin(VariTape::Tag tag)
+    {
+        value();
+        m_open.push_back({m_tape.size(), 0, m_keys.size(), false, false});
+        m_tape.push_back(entry(tag));
+        return true;
+    }
+
+    bool end(VariTape::Tag tag)
+    {
+        const Open open = m_open.back();
+        m_open.pop_back();
+        if (!close(m_tape, open.idx, open.count, tag))
+            return false;
+        if (tag != VariTape::TAG_OBJ_END)
+            return true;
+        if (open.table)
+            m_tablesUsed--;
+        m_keys.resize(open.keys);
+        // read() merges an object or array under a repeated key into the
+        // first value, and fails if that isn't of the same type. Rare enough
+        // to just build the object to find out.
+        if (open.repeated) {
+            VariValue val;
+            VariValueBuilder builder(val);
+            return m_owner.replay(open.idx, m_tape.size(), builder);
+        }
+        return true;
+    }
+
+    // Note key as the next key of open, which is the innermost open object.
+    // Returns false if it already has it.
+    bool addKey(Open& open, std::string_view key)
+    {
+        const size_t n = m_keys.size() - open.keys;
+        if (n < PAIRWISE_MAX) {
+            for (size_t i = open.keys; i < m_keys.size(); i++) {
+                if (m_owner.text(m_keys[i]) == key)
+                    return false;
+            }
+            return true;
+        }
+        if (!open.table) {
+            open.table = true;
+            if (m_tablesUsed == m_tables.size())
+                m_tables.emplace_back();
+            m_tables[m_tablesUsed++].assign(PAIRWISE_MAX * 4, Slot{0, 0});
+            for (size_t i = open.keys; i < m_keys.size(); i++)
+                place(m_tables[m_tablesUsed - 1], {slotHash(m_owner.text(m_keys[i])), uint32_t(i + 1)});
+        }
+        std::vector<Slot>& table = m_tables[m_tablesUsed - 1];
+        if ((n + 1) * 2 > table.size()) {
+            m_rehash.assign(table.size() * 2, Slot{0, 0});
+            for (const Slot& slot : table) {
+                if (slot.pos)
+                    place(m_rehash, slot);
+            }
+            table.swap(m_rehash);
+        }
+        const uint32_t hash = slotHash(key);
+        const size_t mask = table.size() - 1;
+        size_t slot = hash & mask;
+        for (; table[slot].pos; slot = (slot + 1) & mask) {
+            if (table[slot].hash == hash && m_owner.text(m_keys[table[slot].pos - 1]) == key)
+                return false;
+        }
+        table[slot] = {hash, uint32_t(m_keys.size() + 1)};
+        return true;
+    }
+
+    static uint32_t slotHash(std::string_view key) { return VariKey::hashOf(key) >> 32; }
+
+    static void place(std::vector<Slot>& table, Slot entry)
+    {
+        const size_t mask = table.size() - 1;
+        size_t slot = entry.hash & mask;
+        while (table[slot].pos)
+            slot = (slot + 1) & mask;
+        table[slot] = entry;
+    }
+};
+
+VariTape::VariTape(const VariValue& val)
+{
+    append(val);
+}
+
+void VariTape::append(const VariValue& val)
+{
+    varivalue::visit(varivalue::overloaded {
+        [&](std::monostate) { m_tape.push_back(entry(TAG_NULL)); },
+        [&](bool b) { m_tape.push_back(entry(b ? TAG_TRUE : TAG_FALSE)); },
+        [&](const num_t& num) { appendText(m_tape, m_strings, TAG_NUMBER, num.getValStr()); },
+        [&](const std::string& str) { appendText(m_tape, m_strings, TAG_STRING, str); },
+        [&](const object_t& obj) {
+            const size_t open = m_tape.size();
+            m_tape.push_back(entry(TAG_OBJ_BEGIN));
+            for (const auto& [key, member] : obj) {
+                appendText(m_tape, m_strings, TAG_KEY, key);
+                append(member);
+            }
+            if (!close(m_tape, open, obj.size(), TAG_OBJ_END))
+                throw std::runtime_error("JSON tape is too long");
+        },
+        [&](const array_t& arr) {
+            const size_t open = m_tape.size();
+            m_tape.push_back(entry(TAG_ARR_BEGIN));
+            for (const VariValue& elem : arr)
+                append(elem);
+            if (!close(m_tape, open, arr.size(), TAG_ARR_END))
+                throw std::runtime_error("JSON tape is too long");
+        },
+    }, val.m_value);
+}
+
+bool VariTape::read(const char *raw, size_t len)
+{
+    clear();
+    // Decoded text is never longer than the input, and a token every few
+    // bytes is typical, so this usually avoids growing either buffer
+    m_strings.reserve(len);
+    m_tape.reserve(len / 4 + 2);
+    TapeBuilder builder(*this);
+    if (!readSax(builder, raw, len)) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+void VariTape::clear()
+{
+    m_tape.clear();
+    m_strings.clear();
+}
+
+size_t VariTape::skip(size_t idx) const
+{
+    switch (tag(m_tape[idx])) {
+    case TAG_OBJ_BEGIN:
+    case TAG_ARR_BEGIN:
+        return m_tape[idx] & 0xffffffff;
+    default:
+        return idx + (hasText(tag(m_tape[idx])) ? 2 : 1);
+    }
+}
+
+std::string_view VariTape::text(size_t idx) const
+{
+    return std::string_view(m_strings.data() + payload(m_tape[idx]), m_tape[idx + 1]);
+}
+
+template <typename Handler>
+bool VariTape::replay(size_t first, size_t last, Handler& handler) const
+{
+    // Step into containers rather than over them
+    for (size_t idx = first; idx < last; idx += hasText(tag(m_tape[idx])) ? 2 : 1) {
+        bool ok = true;
+        switch (tag(m_tape[idx])) {
+        case TAG_NULL: ok = handler.on_null(); break;
+        case TAG_TRUE: ok = handler.on_bool(true); break;
+        case TAG_FALSE: ok = handler.on_bool(false); break;
+        case TAG_NUMBER: ok = handler.on_number(text(idx)); break;
+        case TAG_STRING: ok = handler.on_string(text(idx)); break;
+        case TAG_KEY: ok = handler.on_key(text(idx)); break;
+        case TAG_OBJ_BEGIN: ok = handler.on_object_begin(); break;
+        case TAG_OBJ_END: ok = handler.on_object_end(); break;
+        case TAG_ARR_BEGIN: ok = handler.on_array_begin(); break;
+        case TAG_ARR_END: ok = handler.on_array_end(); break;
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+VariValue VariTape::toValue() const
+{
+    return root().value();
+}
+
+VariTape::Cursor VariTape::root() const
+{
+    return m_tape.empty() ? Cursor() : Cursor(this, 0);
+}
+
+VariTape::Cursor VariTape::Cursor::at(size_t idx) const
+{
+    const Tag t = tag(m_tape->m_tape[idx]);
+    if (t == TAG_OBJ_END || t == TAG_ARR_END)
+        return Cursor();
+    if (t == TAG_KEY)
+        idx += 2;
+    return Cursor(m_tape, idx);
+}
+
+enum VariValue::VType VariTape::Cursor::getType() const
+{
+    if (!m_tape)
+        return VariValue::VNULL;
+    switch (tag(m_tape->m_tape[m_idx])) {
+    case TAG_TRUE:
+    case TAG_FALSE: return VariValue::VBOOL;
+    case TAG_NUMBER: return VariValue::VNUM;
+    case TAG_STRING: return VariValue::VSTR;
+    case TAG_OBJ_BEGIN: return VariValue::VOBJ;
+    case TAG_ARR_BEGIN: return VariValue::VARR;
+    default: return VariValue::VNULL;
+    }
+}
+
+std::string VariTape::Cursor::getValStr() const
+{
+    switch (getType()) {
+    case VariValue::VSTR:
+    case VariValue::VNUM: return std::string(m_tape->text(m_idx));
+    case VariValue::VBOOL: return get_bool() ? "1" : "";
+    default: return "";
+    }
+}
+
+size_t VariTape::Cursor::size() const
+{
+    if (!isObject() && !isArray())
+        return 0;
+    const uint64_t count = payload(m_tape->m_tape[m_idx]) >> 32;
+    if (count < COUNT_MAX)
+        return count;
+    size_t n = 0;
+    for (Cursor c = child(); c; c = c.next())
+        n++;
+    return n;
+}
+
+VariTape::Cursor VariTape::Cursor::operator[](std::string_view key) const
+{
+    if (!isObject())
+        return Cursor();
+    for (Cursor c = child(); c; c = c.next()) {
+        if (c.key() == key)
+            return c;
+    }
+    return Cursor();
+}
+
+VariTape::Cursor VariTape::Cursor::operator[](size_t index) const
+{
+    if (!isArray())
+        return Cursor();
+    Cursor c = child();
+    for (size_t i = 0; c && i < index; i++)
+        c = c.next();
+    return c;
+}
+
+bool VariTape::Cursor::get_bool() const
+{
+    if (!isBool())
+        throw std::runtime_error("JSON value is not a boolean as expected");
+    return tag(m_tape->m_tape[m_idx]) == TAG_TRUE;
+}
+
+std::string_view VariTape::Cursor::get_str() const
+{
+    if (!isStr())
+        throw std::runtime_error("JSON value is not a string as expected");
+    return m_tape->text(m_idx);
+}
+
+int VariTape::Cursor::get_int() const
+{
+    if (!isNum())
+        throw std::runtime_error("JSON value is not an integer as expected");
+    return VariNum::parseInt(m_tape->text(m_idx));
+}
+
+int64_t VariTape::Cursor::get_int64() const
+{
+    if (!isNum())
+        throw std::runtime_error("JSON value is not an integer as expected");
+    return VariNum::parseInt64(m_tape->text(m_idx));
+}
+
+double VariTape::Cursor::get_real() const
+{
+    if (!isNum())
+        throw std::runtime_error("JSON value is not a number as expected");
+    return VariNum::parseReal(m_tape->text(m_idx));
+}
+
+VariTape::Cursor VariTape::Cursor::child() const
+{
+    if (!isObject() && !isArray())
+        return Cursor();
+    return at(m_idx + 1);
+}
+
+VariTape::Cursor VariTape::Cursor::next() const
+{
+    if (!m_tape)
+        return Cursor();
+    const size_t idx = m_tape->skip(m_idx);
+    if (idx >= m_tape->m_tape.size())
+        return Cursor();
+    return at(idx);
+}
+
+std::string_view VariTape::Cursor::key() const
+{
+    if (!m_tape || m_idx < 2 || tag(m_tape->m_tape[m_idx - 2]) != TAG_KEY)
+        return std::string_view();
+    return m_tape->text(m_idx - 2);
+}
+
+VariValue VariTape::Cursor::value() const
+{
+    VariValue ret;
+    if (!m_tape)
+        return ret;
+    VariValueBuilder builder(ret);
+    // Can't fail: read() rejects the repeated keys that would make it
+    if (!m_tape->replay(m_idx, m_tape->skip(m_idx), builder))
+        throw std::runtime_error("JSON tape is inconsistent");
+    return ret;
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIVALUE_TAPE_H__
+#define __VARIVALUE_TAPE_H__
+
+#include "varivalue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Immutable, flat representation of a JSON document: one tape of 64-bit
+ * entries in document order and one buffer holding all string and number
+ * text. Reading a document into a tape takes a couple of allocations
+ * rather than one per node, and walking it touches memory front to back.
+ *
+ * Each entry has a tag in the top 8 bits and a 56-bit payload:
+ *
+ *   TAG_NULL, TAG_TRUE, TAG_FALSE   no payload
+ *   TAG_STRING, TAG_KEY, TAG_NUMBER offset of the text in the string
+ *                                   buffer, followed by an entry holding
+ *                                   its length
+ *   TAG_OBJ_BEGIN, TAG_ARR_BEGIN    index just past the matching end entry
+ *                                   (at most INDEX_MAX) in the low 32 bits,
+ *                                   element count (saturated at COUNT_MAX)
+ *                                   above that
+ *   TAG_OBJ_END, TAG_ARR_END        index of the matching begin entry
+ *
+ * Object members are a TAG_KEY entry followed by the value. Duplicate keys
+ * are kept; lookups find the first one, and conversion to a VariValue
+ * resolves them exactly like VariValue::read(). Like read(), reading fails
+ * if a repeated key has an object or array value and its first value is of
+ * another type.
+ */
+class VariTape
+{
+public:
+    enum Tag : uint8_t {
+        TAG_NULL = 'n',
+        TAG_TRUE = 't',
+        TAG_FALSE = 'f',
+        TAG_NUMBER = 'd',
+        TAG_STRING = '"',
+        TAG_KEY = 'k',
+        TAG_OBJ_BEGIN = '{',
+        TAG_OBJ_END = '}',
+        TAG_ARR_BEGIN = '[',
+        TAG_ARR_END = ']',
+    };
+
+    static constexpr uint64_t COUNT_MAX = 0xffffff;
+    // Largest index a begin entry can point past
+    static constexpr uint64_t INDEX_MAX = 0xffffffff;
+
+    class Cursor;
+
+    VariTape() = default;
+    // Throws std::runtime_error if val needs a tape longer than INDEX_MAX
+    explicit VariTape(const VariValue& val);
+
+    // Accepts exactly what VariValue::read() accepts, unless the tape would
+    // need more than INDEX_MAX entries
+    bool read(const char *raw, size_t len);
+    bool read(const std::string& rawStr) { return read(rawStr.data(), rawStr.size()); }
+
+    VariValue toValue() const;
+    void clear();
+
+    // The top-level value, or an invalid cursor if the tape is empty
+    Cursor root() const;
+
+    const std::vector<uint64_t>& tape() const { return m_tape; }
+    const std::string& strings() const { return m_strings; }
+
+private:
+    friend class TapeBuilder;
+
+    std::vector<uint64_t> m_tape;
+    std::string m_strings;
+
+    static Tag tag(uint64_t entry) { return Tag(entry >> 56); }
+    static uint64_t payload(uint64_t entry) { return entry & ((uint64_t{1} << 56) - 1); }
+    // Index just past the value starting at idx
+    size_t skip(size_t idx) const;
+    std::string_view text(size_t idx) const;
+    void append(const VariValue& val);
+    template <typename Handler>
+    bool replay(size_t first, size_t last, Handler& handler) const;
+};
+
+/**
+ * Read-only position in a VariTape, mirroring the const VariValue API.
+ * Missing keys and indices give an invalid cursor, which reads as null
+ * like NullUniValue. A cursor is only valid as long as its tape.
+ */
+class VariTape::Cursor
+{
+public:
+    Cursor() = default;
+
+    explicit operator bool() const { return m_tape != nullptr; }
+
+    enum VariValue::VType getType() const;
+    std::string getValStr() const;
+    bool empty() const { return size() == 0; }
+    size_t size() const;
+
+    Cursor operator[](std::string_view key) const;
+    Cursor operator[](size_t index) const;
+    bool exists(std::string_view key) const { return bool((*this)[key]); }
+
+    bool isNull() const { return getType() == VariValue::VNULL; }
+    bool isTrue() const { return getType() == VariValue::VBOOL && get_bool(); }
+    bool isFalse() const { return getType() == VariValue::VBOOL && !get_bool(); }
+    bool isBool() const { return getType() == VariValue::VBOOL; }
+    bool isStr() const { return getType() == VariValue::VSTR; }
+    bool isNum() const { return getType() == VariValue::VNUM; }
+    bool isArray() const { return getType() == VariValue::VARR; }
+    bool isObject() const { return getType() == VariValue::VOBJ; }
+
+    // Strict type-specific getters, these throw std::runtime_error if the
+    // value is of unexpected type
+    bool get_bool() const;
+    std::string_view get_str() const;
+    int get_int() const;
+    int64_t get_int64() const;
+    double get_real() const;
+
+    // Iteration: the first element or member of a container, and the
+    // following sibling. Both give an invalid cursor at the end.
+    Cursor child() const;
+    Cursor next() const;
+    // The key of an object member
+    std::string_view key() const;
+
+    // Copy this value and everything below it into a VariValue
+    VariValue value() const;
+
+private:
+    friend class VariTape;
+
+    const VariTape *m_tape{nullptr};
+    size_t m_idx{0};
+
+    Cursor(const VariTape *tape, size_t idx) : m_tape(tape), m_idx(idx) {}
+    // The cursor at idx, or an invalid one if idx ends the container
+    Cursor at(size_t idx) const;
+};
+
+#endif // __VARIVALUE_TAPE_H__
@@ -0,0 +1,280 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "varivalue_utf8.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VARIVALUE_UTF8_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+bool validUtf8Scalar(const unsigned char *str, size_t len)
+{
+    size_t i = 0;
+    while (i < len) {
+        // Skip ASCII a word at a time
+        while (len - i >= 8) {
+            uint64_t w;
+            memcpy(&w, str + i, sizeof(w));
+            if (w & 0x8080808080808080ULL)
+                break;
+            i += 8;
+        }
+        if (i == len)
+            break;
+
+        const unsigned char ch = str[i];
+        if (ch < 0x80) {
+            i++;
+            continue;
+        }
+
+        size_t follow;
+        unsigned char lo = 0x80, hi = 0xbf; // range of the first continuation byte
+        if (ch >= 0xc2 && ch <= 0xdf) {
+            follow = 1;
+        } else if (ch >= 0xe0 && ch <= 0xef) {
+            follow = 2;
+            if (ch == 0xe0) lo = 0xa0;      // overlong
+            else if (ch == 0xed) hi = 0x9f; // surrogate
+        } else if (ch >= 0xf0 && ch <= 0xf4) {
+            follow = 3;
+            if (ch == 0xf0) lo = 0x90;      // overlong
+            else if (ch == 0xf4) hi = 0x8f; // above U+10FFFF
+        } else {
+            return false;
+        }
+        if (len - i - 1 < follow)
+            return false;
+        if (str[i + 1] < lo || str[i + 1] > hi)
+            return false;
+        for (size_t j = 2; j <= follow; j++) {
+            if ((str[i + j] & 0xc0) != 0x80)
+                return false;
+        }
+        i += follow + 1;
+    }
+    return true;
+}
+
+#ifdef VARIVALUE_UTF8_X86
+
+// Lookup-table validation after Keiser & Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte". Each pair of adjacent bytes is classified
+// by three 16-entry tables (high and low nibble of the first byte, high
+// nibble of the second); a set bit common to all three marks an error.
+// Third and fourth bytes of a sequence are checked separately.
+constexpr uint8_t TOO_SHORT = 1 << 0;      // 11______ 0_______ or 11______ 11______
+constexpr uint8_t TOO_LONG = 1 << 1;       // 0_______ 10______
+constexpr uint8_t OVERLONG_3 = 1 << 2;     // 11100000 100_____
+constexpr uint8_t TOO_LARGE = 1 << 3;      // 11110100 1001____ and up
+constexpr uint8_t SURROGATE = 1 << 4;      // 11101101 101_____
+constexpr uint8_t OVERLONG_2 = 1 << 5;     // 1100000_ 10______
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6; // 11110101 1000____ and up
+constexpr uint8_t OVERLONG_4 = 1 << 6;     // 11110000 1000____
+constexpr uint8_t TWO_CONTS = 1 << 7;      // 10______ 10______
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+alignas(16) constexpr uint8_t BYTE_1_HIGH[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+alignas(16) constexpr uint8_t BYTE_1_LOW[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+alignas(16) constexpr uint8_t BYTE_2_HIGH[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+// Largest byte value that may end a block without leaving a sequence open
+alignas(32) constexpr uint8_t MAX_END[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf,
+};
+
+__attribute__((target("ssse3")))
+inline __m128i lookupSSSE3(const uint8_t *table, __m128i nibbles)
+{
+    return _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(table)), nibbles);
+}
+
+__attribute__((target("ssse3")))
+bool validUtf8SSSE3(const unsigned char *str, size_t len)
+{
+    const __m128i lowNibble = _mm_set1_epi8(0x0f);
+    const __m128i maxEnd = _mm_load_si128(reinterpret_cast<const __m128i*>(MAX_END + 16));
+    __m128i error = _mm_setzero_si128();
+    __m128i prevInput = _mm_setzero_si128();
+    __m128i prevIncomplete = _mm_setzero_si128();
+
+    for (size_t pos = 0; pos < len; pos += 16) {
+        __m128i input;
+        if (len - pos >= 16) {
+            input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + pos));
+        } else {
+            alignas(16) unsigned char tail[16] = {};
+            memcpy(tail, str + pos, len - pos);
+            input = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+        }
+
+        if (!_mm_movemask_epi8(input)) {
+            error = _mm_or_si128(error, prevIncomplete);
+        } else {
+            const __m128i prev1 = _mm_alignr_epi8(input, prevInput, 15);
+            const __m128i byte1High = lookupSSSE3(BYTE_1_HIGH, _mm_and_si128(_mm_srli_epi16(prev1, 4), lowNibble));
+            const __m128i byte1Low = lookupSSSE3(BYTE_1_LOW, _mm_and_si128(prev1, lowNibble));
+            const __m128i byte2High = lookupSSSE3(BYTE_2_HIGH, _mm_and_si128(_mm_srli_epi16(input, 4), lowNibble));
+            const __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+            const __m128i prev2 = _mm_alignr_epi8(input, prevInput, 14);
+            const __m128i prev3 = _mm_alignr_epi8(input, prevInput, 13);
+            const __m128i isThird = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+            const __m128i isFourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+            const __m128i must23 = _mm_and_si128(_mm_or_si128(isThird, isFourth), _mm_set1_epi8(static_cast<char>(0x80)));
+
+            error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+            prevIncomplete = _mm_subs_epu8(input, maxEnd);
+        }
+        prevInput = input;
+    }
+    error = _mm_or_si128(error, prevIncomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+}
+
+__attribute__((target("avx2")))
+inline __m256i lookupAVX2(const uint8_t *table, __m256i nibbles)
+{
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table))), nibbles);
+}
+
+__attribute__((target("avx2")))
+bool validUtf8AVX2(const unsigned char *str, size_t len)
+{
+    const __m256i lowNibble = _mm256_set1_epi8(0x0f);
+    const __m256i maxEnd = _mm256_load_si256(reinterpret_cast<const __m256i*>(MAX_END));
+    __m256i error = _mm256_setzero_si256();
+    __m256i prevInput = _mm256_setzero_si256();
+    __m256i prevIncomplete = _mm256_setzero_si256();
+
+    for (size_t pos = 0; pos < len; pos += 32) {
+        __m256i input;
+        if (len - pos >= 32) {
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + pos));
+        } else {
+            alignas(32) unsigned char tail[32] = {};
+            memcpy(tail, str + pos, len - pos);
+            input = _mm256_load_si256(reinterpret_cast<const __m256i*>(tail));
+        }
+
+        if (!_mm256_movemask_epi8(input)) {
+            error = _mm256_or_si256(error, prevIncomplete);
+        } else {
+            // Bytes 31..16 of the previous block followed by bytes 15..0 of this one
+            const __m256i shifted = _mm256_permute2x128_si256(prevInput, input, 0x21);
+            const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+            const __m256i byte1High = lookupAVX2(BYTE_1_HIGH, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), lowNibble));
+            const __m256i byte1Low = lookupAVX2(BYTE_1_LOW, _mm256_and_si256(prev1, lowNibble));
+            const __m256i byte2High = lookupAVX2(BYTE_2_HIGH, _mm256_and_si256(_mm256_srli_epi16(input, 4), lowNibble));
+            const __m256i special = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+
+            const __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+            const __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+            const __m256i isThird = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+            const __m256i isFourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+            const __m256i must23 = _mm256_and_si256(_mm256_or_si256(isThird, isFourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+
+            error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+            prevIncomplete = _mm256_subs_epu8(input, maxEnd);
+        }
+        prevInput = input;
+    }
+    error = _mm256_or_si256(error, prevIncomplete);
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+using ValidateFn = bool (*)(const unsigned char *, size_t);
+
+ValidateFn selectValidator(Utf8Impl impl)
+{
+    switch (impl) {
+#ifdef VARIVALUE_UTF8_X86
+    case UTF8_SSSE3: return validUtf8SSSE3;
+    case UTF8_AVX2: return validUtf8AVX2;
+#endif
+    case UTF8_AUTO: {
+        static const ValidateFn best = [] {
+            if (utf8ImplSupported(UTF8_AVX2))
+                return selectValidator(UTF8_AVX2);
+            if (utf8ImplSupported(UTF8_SSSE3))
+                return selectValidator(UTF8_SSSE3);
+            return selectValidator(UTF8_SCALAR);
+        }();
+        return best;
+    }
+    default: return validUtf8Scalar;
+    }
+}
+
+} // namespace
+
+bool utf8ImplSupported(Utf8Impl impl)
+{
+    switch (impl) {
+    case UTF8_AUTO:
+    case UTF8_SCALAR:
+        return true;
+#ifdef VARIVALUE_UTF8_X86
+    case UTF8_SSSE3:
+        return __builtin_cpu_supports("ssse3");
+    case UTF8_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+bool validUtf8(const char *str, size_t len, Utf8Impl impl)
+{
+    const unsigned char *ustr = reinterpret_cast<const unsigned char*>(str);
+    // Not worth setting up vector state for a character or two
+    if (impl == UTF8_AUTO && len < 16)
+        return validUtf8Scalar(ustr, len);
+    if (!utf8ImplSupported(impl))
+        return false;
+    return selectValidator(impl)(ustr, len);
+}
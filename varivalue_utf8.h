@@ -0,0 +1,32 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIVALUE_UTF8_H__
+#define __VARIVALUE_UTF8_H__
+
+#include <cstddef>
+
+enum Utf8Impl {
+    UTF8_AUTO,
+    UTF8_SCALAR,
+    UTF8_SSSE3,
+    UTF8_AVX2,
+};
+
+// Whether the running cpu can execute the given implementation
+bool utf8ImplSupported(Utf8Impl impl);
+
+/**
+ * Check that [str, str + len) is well-formed UTF-8: no overlong forms, no
+ * surrogates, nothing above U+10FFFF and no truncated sequences.
+ *
+ * This is stricter than JSONUTF8StringFilter, which also accepts (and
+ * normalizes) overlong forms, surrogates and code points up to U+1FFFFF.
+ * Anything accepted here passes through the filter byte for byte, so
+ * callers can skip the filter for accepted input and fall back to it for
+ * everything else without changing the outcome.
+ */
+bool validUtf8(const char *str, size_t len, Utf8Impl impl = UTF8_AUTO);
+
+#endif // __VARIVALUE_UTF8_H__
@@ -7,8 +7,15 @@
 #include <vector>
 #include <stdio.h>
 #include "varivalue_util.h"
+#include "varivalue_utf8.h"
 #include "univalue_utffilter.h"
 
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 static bool json_isdigit(int ch)
 {
     return ((ch >= '0') && (ch <= '9'));
@@ -41,10 +48,60 @@ static const char *hatoui(const char *first, const char *last,
     return first;
 }
 
-enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
-                            const char *raw, const char *end)
+// Bytes that end a run of string characters which can be copied as-is. With
+// AllowUtf8 set, non-ASCII bytes are part of the run.
+template <bool AllowUtf8>
+static bool isStringSpecial(unsigned char ch)
+{
+    return ch == '"' || ch == '\\' || ch < 0x20 || (!AllowUtf8 && ch >= 0x80);
+}
+
+// Find the first special byte in [raw, end), 16 (SSE2) or 8 bytes at a time
+template <bool AllowUtf8>
+static const char *findStringSpecial(const char *raw, const char *end)
 {
-    tokenVal.clear();
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+    while (end - raw >= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw));
+        // Signed compare: catches both control characters and bytes >= 0x80
+        __m128i low = _mm_cmplt_epi8(v, space);
+        if (AllowUtf8)
+            low = _mm_andnot_si128(_mm_cmplt_epi8(v, _mm_setzero_si128()), low);
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), low);
+        const int mask = _mm_movemask_epi8(special);
+        if (mask)
+            return raw + __builtin_ctz(mask);
+        raw += 16;
+    }
+#else
+    constexpr uint64_t ones = ~uint64_t{0} / 255;
+    constexpr uint64_t highs = ones * 0x80;
+    const auto haszero = [](uint64_t x) { return (x - ones) & ~x & highs; };
+    while (end - raw >= 8) {
+        uint64_t w;
+        memcpy(&w, raw, sizeof(w));
+        // The control character test may misfire next to bytes >= 0x80,
+        // which only means falling back to the bytewise loop below early
+        uint64_t special = haszero(w ^ (ones * '"')) | haszero(w ^ (ones * '\\')) | ((w - ones * 0x20) & ~w & highs);
+        if (!AllowUtf8)
+            special |= w & highs;
+        if (special)
+            break;
+        raw += 8;
+    }
+#endif
+    while (raw < end && !isStringSpecial<AllowUtf8>(*raw))
+        raw++;
+    return raw;
+}
+
+enum jtokentype getJsonToken(std::string_view& tokenVal, std::string& scratch,
+                             unsigned int& consumed, const char *raw, const char *end)
+{
+    tokenVal = {};
     consumed = 0;
 
     const char *rawStart = raw;
@@ -85,21 +142,23 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
 
     case 'n':
     case 't':
-    case 'f':
-        if (!strncmp(raw, "null", 4)) {
+    case 'f': {
+        const std::string_view rest(raw, end - raw);
+        if (rest.substr(0, 4) == "null") {
             raw += 4;
             consumed = (raw - rawStart);
             return JTOK_KW_NULL;
-        } else if (!strncmp(raw, "true", 4)) {
+        } else if (rest.substr(0, 4) == "true") {
             raw += 4;
             consumed = (raw - rawStart);
             return JTOK_KW_TRUE;
-        } else if (!strncmp(raw, "false", 5)) {
+        } else if (rest.substr(0, 5) == "false") {
             raw += 5;
             consumed = (raw - rawStart);
             return JTOK_KW_FALSE;
         } else
             return JTOK_ERR;
+        }
 
     case '-':
     case '0':
@@ -113,59 +172,46 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
     case '8':
     case '9': {
         // part 1: int
-        std::string numStr;
-
         const char *first = raw;
 
         const char *firstDigit = first;
         if (!json_isdigit(*firstDigit))
             firstDigit++;
-        if ((*firstDigit == '0') && json_isdigit(firstDigit[1]))
+        if (firstDigit + 1 < end && (*firstDigit == '0') && json_isdigit(firstDigit[1]))
             return JTOK_ERR;
 
-        numStr += *raw;                       // copy first char
-        raw++;
+        raw++;                                // first char
 
         if ((*first == '-') && (raw < end) && (!json_isdigit(*raw)))
             return JTOK_ERR;
 
-        while (raw < end && json_isdigit(*raw)) {  // copy digits
-            numStr += *raw;
+        while (raw < end && json_isdigit(*raw))    // digits
             raw++;
-        }
 
         // part 2: frac
         if (raw < end && *raw == '.') {
-            numStr += *raw;                   // copy .
-            raw++;
+            raw++;                            // .
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) // digits
                 raw++;
-            }
         }
 
         // part 3: exp
         if (raw < end && (*raw == 'e' || *raw == 'E')) {
-            numStr += *raw;                   // copy E
-            raw++;
+            raw++;                            // E
 
-            if (raw < end && (*raw == '-' || *raw == '+')) { // copy +/-
-                numStr += *raw;
+            if (raw < end && (*raw == '-' || *raw == '+')) // +/-
                 raw++;
-            }
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) // digits
                 raw++;
-            }
         }
 
-        tokenVal = numStr;
+        tokenVal = std::string_view(first, raw - first);
         consumed = (raw - rawStart);
         return JTOK_NUMBER;
         }
@@ -173,8 +219,27 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
     case '"': {
         raw++;                                // skip "
 
-        std::string valStr;
-        JSONUTF8StringFilter writer(valStr);
+        // Strings without escapes are returned as a view of the input, as
+        // long as any multi-byte characters in them are well-formed
+        const char *valStart = raw;
+        raw = findStringSpecial<false>(raw, end);
+        if (raw < end && (unsigned char)*raw >= 0x80) {
+            const char *valEnd = findStringSpecial<true>(raw, end);
+            if (valEnd < end && *valEnd == '"' && validUtf8(raw, valEnd - raw))
+                raw = valEnd;
+        }
+        if (raw < end && *raw == '"') {
+            tokenVal = std::string_view(valStart, raw - valStart);
+            raw++;                            // skip "
+            consumed = (raw - rawStart);
+            return JTOK_STRING;
+        }
+
+        // Otherwise the value has to be decoded. The clean prefix is
+        // copied as-is, which is exactly what the filter would do with it.
+        scratch.assign(valStart, raw);
+        JSONUTF8StringFilter writer(scratch);
+        const char *slowUntil = raw;          // end of a run that failed validation
 
         while (true) {
             if (raw >= end || (unsigned char)*raw < 0x20)
@@ -219,15 +284,32 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
                 break;                        // stop scanning
             }
 
+            else if ((unsigned char)*raw >= 0x80) {
+                // Well-formed runs are copied whole. Anything else (overlong
+                // forms, surrogates, errors) goes through the UTF-8 decoder.
+                const char *run = raw < slowUntil ? raw : findStringSpecial<true>(raw, end);
+                if (run > raw && validUtf8(raw, run - raw)) {
+                    writer.append_utf8(raw, run);
+                    raw = run;
+                } else {
+                    slowUntil = std::max(slowUntil, run);
+                    do {
+                        writer.push_back(*raw);
+                        raw++;
+                    } while (raw < end && (unsigned char)*raw >= 0x80);
+                }
+            }
+
             else {
-                writer.push_back(*raw);
-                raw++;
+                const char *run = findStringSpecial<false>(raw, end);
+                writer.append_ascii(raw, run);
+                raw = run;
             }
         }
 
         if (!writer.finalize())
             return JTOK_ERR;
-        tokenVal = valStr;
+        tokenVal = scratch;
         consumed = (raw - rawStart);
         return JTOK_STRING;
         }
@@ -237,10 +319,11 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
     }
 }
 
-bool validNumStr(const std::string& s)
+bool validNumStr(std::string_view s)
 {
-    std::string tokenVal;
+    std::string_view tokenVal;
+    std::string scratch;
     unsigned int consumed;
-    enum jtokentype tt = getJsonToken(tokenVal, consumed, s.data(), s.data() + s.size());
+    enum jtokentype tt = getJsonToken(tokenVal, scratch, consumed, s.data(), s.data() + s.size());
     return (tt == JTOK_NUMBER);
 }
@@ -6,6 +6,7 @@
 #define __VARIVALUE_UTIL_H__
 
 #include <string>
+#include <string_view>
 
 enum jtokentype {
     JTOK_ERR        = -1,
@@ -33,8 +34,14 @@ constexpr bool json_isspace(int ch)
     return ch == 0x20 || ch == 0x09 || ch == 0x0a || ch == 0x0d;
 }
 
-jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed, const char *raw, const char *end);
+/**
+ * Read the next token from [raw, end). For numbers and strings, tokenVal
+ * refers to the token's value: numbers and strings that need no decoding are
+ * a view into the input, anything that had to be unescaped is decoded into
+ * scratch. tokenVal stays valid until the input or scratch is modified.
+ */
+jtokentype getJsonToken(std::string_view& tokenVal, std::string& scratch, unsigned int& consumed, const char *raw, const char *end);
 
-bool validNumStr(const std::string& s);
+bool validNumStr(std::string_view s);
 
 #endif // __VARIVALUE_UTIL_H__
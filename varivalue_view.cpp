@@ -0,0 +1,389 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "varivalue_view.h"
+#include "varivalue_util.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+[[noreturn]] void parseError()
+{
+    throw std::runtime_error("JSON parse error");
+}
+
+// Bytes that end a number or keyword
+constexpr bool isDelimiter(char c)
+{
+    return json_isspace(c) || c == ',' || c == ':' || c == ']' || c == '}' ||
+           c == '[' || c == '{' || c == '"';
+}
+
+// Bytes that matter when skipping over a container
+bool isStructural(char c)
+{
+    static const auto table = [] {
+        std::array<bool, 256> t{};
+        for (unsigned char ch : {'"', '{', '}', '[', ']'})
+            t[ch] = true;
+        return t;
+    }();
+    return table[(unsigned char)c];
+}
+
+// Decode the quoted string at [first, last)
+std::string_view decodeString(const char *first, const char *last, std::string& scratch)
+{
+    std::string_view tokenVal;
+    unsigned int consumed;
+    if (getJsonToken(tokenVal, scratch, consumed, first, last) != JTOK_STRING)
+        parseError();
+    return tokenVal;
+}
+
+} // namespace
+
+size_t VariViewDoc::skipSpace(size_t pos) const
+{
+    const size_t len = m_end - m_begin;
+    while (pos < len && json_isspace(m_begin[pos]))
+        pos++;
+    return pos;
+}
+
+size_t VariViewDoc::skipString(size_t pos) const
+{
+    const char *p = m_begin + pos + 1;
+    while (true) {
+        p = static_cast<const char*>(memchr(p, '"', m_end - p));
+        if (!p)
+            parseError();
+        // The quote is escaped if preceded by an odd number of backslashes
+        const char *q = p;
+        while (q > m_begin + pos + 1 && q[-1] == '\\')
+            q--;
+        if ((p - q) % 2 == 0)
+            return p + 1 - m_begin;
+        p++;
+    }
+}
+
+size_t VariViewDoc::skipValue(size_t pos) const
+{
+    const size_t len = m_end - m_begin;
+    if (pos >= len)
+        parseError();
+
+    switch (m_begin[pos]) {
+    case '"':
+        return skipString(pos);
+    case '{':
+    case '[': {
+        size_t depth = 0;
+        while (pos < len) {
+            while (pos < len && !isStructural(m_begin[pos]))
+                pos++;
+            if (pos == len)
+                break;
+            switch (m_begin[pos]) {
+            case '"':
+                pos = skipString(pos);
+                continue;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0)
+                    return pos + 1;
+                break;
+            }
+            pos++;
+        }
+        parseError();
+    }
+    default: {
+        const size_t start = pos;
+        while (pos < len && !isDelimiter(m_begin[pos]))
+            pos++;
+        if (pos == start)
+            parseError();
+        return pos;
+    }
+    }
+}
+
+size_t VariViewDoc::expect(size_t pos, char c) const
+{
+    pos = skipSpace(pos);
+    if (pos >= size_t(m_end - m_begin) || m_begin[pos] != c)
+        parseError();
+    return pos + 1;
+}
+
+// Call fn(rawKey, valuePos) for each member of the object at pos, in
+// document order, until it returns true. rawKey includes the quotes.
+template <typename Fn>
+void VariViewDoc::members(size_t pos, Fn&& fn) const
+{
+    pos = skipSpace(pos + 1);
+    if (pos < size_t(m_end - m_begin) && m_begin[pos] == '}')
+        return;
+    while (true) {
+        if (pos >= size_t(m_end - m_begin) || m_begin[pos] != '"')
+            parseError();
+        const size_t keyEnd = skipString(pos);
+        const size_t value = skipSpace(expect(keyEnd, ':'));
+        if (fn(std::string_view(m_begin + pos, keyEnd - pos), value))
+            return;
+        pos = skipSpace(skipValue(value));
+        if (pos >= size_t(m_end - m_begin))
+            parseError();
+        if (m_begin[pos] == '}')
+            return;
+        if (m_begin[pos] != ',')
+            parseError();
+        pos = skipSpace(pos + 1);
+    }
+}
+
+size_t VariViewDoc::element(size_t array, size_t index) const
+{
+    // Short walks aren't worth a cache entry
+    auto it = m_arrays.find(array);
+    if (it == m_arrays.end() && index < ARRAY_STRIDE) {
+        ArrayIndex scratch;
+        return element(array, index, scratch);
+    }
+    return element(array, index, m_arrays[array]);
+}
+
+size_t VariViewDoc::element(size_t array, size_t index, ArrayIndex& cache) const
+{
+    if (cache.marks.empty()) {
+        const size_t first = skipSpace(array + 1);
+        if (first < size_t(m_end - m_begin) && m_begin[first] == ']')
+            cache.size = 0;
+        cache.marks.push_back(first);
+    }
+    if (index >= cache.size)
+        return SIZE_MAX;
+
+    size_t mark = std::min(index / ARRAY_STRIDE, cache.marks.size() - 1);
+    size_t i = mark * ARRAY_STRIDE;
+    size_t pos = cache.marks[mark];
+    while (i < index) {
+        pos = skipSpace(skipValue(pos));
+        if (pos >= size_t(m_end - m_begin))
+            parseError();
+        if (m_begin[pos] == ']') {
+            cache.size = i + 1;
+            return SIZE_MAX;
+        }
+        if (m_begin[pos] != ',')
+            parseError();
+        pos = skipSpace(pos + 1);
+        if (++i % ARRAY_STRIDE == 0 && i / ARRAY_STRIDE == cache.marks.size())
+            cache.marks.push_back(pos);
+    }
+    return pos;
+}
+
+VariView VariViewDoc::root() const
+{
+    const size_t pos = skipSpace(0);
+    if (m_begin + pos == m_end)
+        parseError();
+    return VariView(this, pos);
+}
+
+char VariView::lead() const
+{
+    return m_doc ? m_doc->m_begin[m_pos] : 'n';
+}
+
+enum VariValue::VType VariView::getType() const
+{
+    switch (lead()) {
+    case '{': return VariValue::VOBJ;
+    case '[': return VariValue::VARR;
+    case '"': return VariValue::VSTR;
+    case 't':
+    case 'f': return VariValue::VBOOL;
+    case 'n': return VariValue::VNULL;
+    case '-':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        return VariValue::VNUM;
+    }
+    parseError();
+}
+
+std::string VariView::getValStr() const
+{
+    if (isObject() || isArray())
+        return "";
+    return value().getValStr();
+}
+
+bool VariView::empty() const
+{
+    if (!isObject() && !isArray())
+        return true;
+    const size_t pos = m_doc->skipSpace(m_pos + 1);
+    return pos < size_t(m_doc->m_end - m_doc->m_begin) &&
+           (m_doc->m_begin[pos] == '}' || m_doc->m_begin[pos] == ']');
+}
+
+size_t VariView::size() const
+{
+    if (isObject()) {
+        size_t n = 0;
+        m_doc->members(m_pos, [&](std::string_view, size_t) { n++; return false; });
+        return n;
+    }
+    if (isArray()) {
+        // Walking to the end fills in the offset cache for later lookups
+        VariViewDoc::ArrayIndex& cache = m_doc->m_arrays[m_pos];
+        m_doc->element(m_pos, SIZE_MAX - 1, cache);
+        return cache.size;
+    }
+    return 0;
+}
+
+bool VariView::getBool() const
+{
+    return isBool() && value().getBool();
+}
+
+VariView VariView::operator[](std::string_view key) const
+{
+    if (!isObject())
+        return VariView();
+    VariView ret;
+    std::string scratch;
+    m_doc->members(m_pos, [&](std::string_view rawKey, size_t value) {
+        std::string_view name = rawKey.substr(1, rawKey.size() - 2);
+        if (name.find('\\') != std::string_view::npos)
+            name = decodeString(rawKey.data(), rawKey.data() + rawKey.size(), scratch);
+        if (name != key)
+            return false;
+        ret = VariView(m_doc, value);
+        return true;
+    });
+    return ret;
+}
+
+VariView VariView::operator[](size_t index) const
+{
+    if (!isArray())
+        return VariView();
+    const size_t pos = m_doc->element(m_pos, index);
+    return pos == SIZE_MAX ? VariView() : VariView(m_doc, pos);
+}
+
+bool VariView::exists(std::string_view key) const
+{
+    return (*this)[key].m_doc != nullptr;
+}
+
+bool VariView::isTrue() const
+{
+    return lead() == 't' && value().isTrue();
+}
+
+bool VariView::isFalse() const
+{
+    return lead() == 'f' && value().isFalse();
+}
+
+std::vector<std::string> VariView::getKeys() const
+{
+    if (!isObject())
+        throw std::runtime_error("JSON value is not an object as expected");
+    std::vector<std::string> keys;
+    std::string scratch;
+    m_doc->members(m_pos, [&](std::string_view rawKey, size_t) {
+        keys.emplace_back(decodeString(rawKey.data(), rawKey.data() + rawKey.size(), scratch));
+        return false;
+    });
+    return keys;
+}
+
+bool VariView::get_bool() const
+{
+    if (!isBool())
+        throw std::runtime_error("JSON value is not a boolean as expected");
+    return value().get_bool();
+}
+
+std::string VariView::get_str() const
+{
+    if (!isStr())
+        throw std::runtime_error("JSON value is not a string as expected");
+    return value().get_str();
+}
+
+int VariView::get_int() const
+{
+    if (!isNum())
+        throw std::runtime_error("JSON value is not an integer as expected");
+    return value().get_int();
+}
+
+int64_t VariView::get_int64() const
+{
+    if (!isNum())
+        throw std::runtime_error("JSON value is not an integer as expected");
+    return value().get_int64();
+}
+
+double VariView::get_real() const
+{
+    if (!isNum())
+        throw std::runtime_error("JSON value is not a number as expected");
+    return value().get_real();
+}
+
+const VariView& VariView::get_obj() const
+{
+    if (!isObject())
+        throw std::runtime_error("JSON value is not an object as expected");
+    return *this;
+}
+
+const VariView& VariView::get_array() const
+{
+    if (!isArray())
+        throw std::runtime_error("JSON value is not an array as expected");
+    return *this;
+}
+
+VariValue VariView::value() const
+{
+    VariValue ret;
+    if (!m_doc)
+        return ret;
+    const std::string_view text = raw();
+    if (!ret.read(text.data(), text.size()))
+        parseError();
+    return ret;
+}
+
+std::string_view VariView::raw() const
+{
+    if (!m_doc)
+        return "null";
+    return std::string_view(m_doc->m_begin + m_pos, m_doc->skipValue(m_pos) - m_pos);
+}
+
+const VariView find_value(const VariView& obj, std::string_view name)
+{
+    return obj[name];
+}
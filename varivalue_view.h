@@ -0,0 +1,134 @@
+// Copyright (c) 2021 Cory Fields
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __VARIVALUE_VIEW_H__
+#define __VARIVALUE_VIEW_H__
+
+#include "varivalue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class VariViewDoc;
+
+/**
+ * Read-only view of one value inside a VariViewDoc. Mirrors the const
+ * VariValue API, but nothing is parsed until it is asked for: looking up a
+ * key or an index skips over everything in between without allocating, and
+ * only the values that are actually read get decoded.
+ *
+ * Skipped values are only checked for balanced brackets and strings, so
+ * unlike VariValue::read() a view doesn't reject a malformed document up
+ * front. Malformed input is reported with a std::runtime_error from
+ * whichever call runs into it.
+ *
+ * Missing keys and indices give a null view, like NullUniValue. A view is
+ * only valid as long as its document and the underlying buffer.
+ */
+class VariView
+{
+public:
+    VariView() = default;
+
+    enum VariValue::VType getType() const;
+    enum VariValue::VType type() const { return getType(); }
+    std::string getValStr() const;
+    bool empty() const;
+    size_t size() const;
+
+    bool getBool() const;
+    VariView operator[](std::string_view key) const;
+    VariView operator[](size_t index) const;
+    bool exists(std::string_view key) const;
+
+    bool isNull() const { return getType() == VariValue::VNULL; }
+    bool isTrue() const;
+    bool isFalse() const;
+    bool isBool() const { return getType() == VariValue::VBOOL; }
+    bool isStr() const { return getType() == VariValue::VSTR; }
+    bool isNum() const { return getType() == VariValue::VNUM; }
+    bool isArray() const { return getType() == VariValue::VARR; }
+    bool isObject() const { return getType() == VariValue::VOBJ; }
+
+    // Strict type-specific getters, these throw std::runtime_error if the
+    // value is of unexpected type. Keys are in document order, duplicates
+    // included.
+    std::vector<std::string> getKeys() const;
+    bool get_bool() const;
+    std::string get_str() const;
+    int get_int() const;
+    int64_t get_int64() const;
+    double get_real() const;
+    const VariView& get_obj() const;
+    const VariView& get_array() const;
+
+    // Parse this value and everything below it into a VariValue
+    VariValue value() const;
+
+    // The JSON text of this value
+    std::string_view raw() const;
+
+private:
+    friend class VariViewDoc;
+
+    const VariViewDoc *m_doc{nullptr};
+    size_t m_pos{0};
+
+    VariView(const VariViewDoc *doc, size_t pos) : m_doc(doc), m_pos(pos) {}
+    char lead() const;
+};
+
+/**
+ * A JSON document read lazily through VariView. The buffer is not copied
+ * and must outlive the document and all views into it.
+ *
+ * Arrays that are indexed into remember the offset of every
+ * ARRAY_STRIDE-th element they passed, so repeated lookups in the same
+ * array only skip over a few elements. As this cache is updated from const
+ * calls, a document must not be used from several threads at once.
+ */
+class VariViewDoc
+{
+public:
+    static constexpr size_t ARRAY_STRIDE = 32;
+
+    VariViewDoc(const char *raw, size_t len) : m_begin(raw), m_end(raw + len) {}
+    explicit VariViewDoc(std::string_view raw) : VariViewDoc(raw.data(), raw.size()) {}
+    VariViewDoc(const VariViewDoc&) = delete;
+    VariViewDoc& operator=(const VariViewDoc&) = delete;
+
+    // The top-level value
+    VariView root() const;
+
+private:
+    friend class VariView;
+
+    struct ArrayIndex
+    {
+        std::vector<size_t> marks; // offsets of elements 0, STRIDE, 2 * STRIDE...
+        size_t size{SIZE_MAX};     // element count, once the end was seen
+    };
+
+    const char *m_begin;
+    const char *m_end;
+    mutable std::unordered_map<size_t, ArrayIndex> m_arrays;
+
+    size_t skipSpace(size_t pos) const;
+    size_t skipString(size_t pos) const;
+    size_t skipValue(size_t pos) const;
+    size_t expect(size_t pos, char c) const;
+    template <typename Fn>
+    void members(size_t object, Fn&& fn) const;
+    // Offset of an array element, or SIZE_MAX if out of range
+    size_t element(size_t array, size_t index) const;
+    size_t element(size_t array, size_t index, ArrayIndex& cache) const;
+};
+
+const VariView find_value(const VariView& obj, std::string_view name);
+
+#endif // __VARIVALUE_VIEW_H__
@@ -3,12 +3,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or https://opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
 #include <iomanip>
 #include <stdio.h>
+#include <vector>
 #include "varivalue.h"
 #include "univalue_escapes.h"
 
-static std::string json_escape(const std::string& inS)
+static std::string json_escape(std::string_view inS)
 {
     std::string outS;
     outS.reserve(inS.size() * 2);
@@ -31,7 +33,7 @@ static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, std::
     s.append(prettyIndent * indentLevel, ' ');
 }
 
-void writeArray(const array_t& arr, std::string& s, unsigned int prettyIndent, unsigned int indentLevel)
+void writeArray(const array_t& arr, std::string& s, unsigned int prettyIndent, unsigned int indentLevel, VariValue::WriteOrder order)
 {
     s += "[";
     if (prettyIndent)
@@ -40,7 +42,7 @@ void writeArray(const array_t& arr, std::string& s, unsigned int prettyIndent, u
     for (unsigned int i = 0; i < arr.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += arr[i].write(prettyIndent, indentLevel + 1);
+        s += arr[i].write(prettyIndent, indentLevel + 1, order);
         if (i != (arr.size() - 1)) {
             s += ",";
         }
@@ -53,22 +55,32 @@ void writeArray(const array_t& arr, std::string& s, unsigned int prettyIndent, u
     s += "]";
 }
 
-void writeObject(const object_t& obj, std::string& s, unsigned int prettyIndent, unsigned int indentLevel)
+void writeObject(const object_t& obj, std::string& s, unsigned int prettyIndent, unsigned int indentLevel, VariValue::WriteOrder order)
 {
+    // Only sorting needs a separate list of the members
+    std::vector<const object_t::value_type*> sorted;
+    if (order == VariValue::WRITE_SORTED) {
+        sorted.reserve(obj.size());
+        for (const auto& member : obj)
+            sorted.push_back(&member);
+        std::sort(sorted.begin(), sorted.end(), [](const object_t::value_type *a, const object_t::value_type *b) {
+            return a->first.view() < b->first.view();
+        });
+    }
+
     s += "{";
     if (prettyIndent)
         s += "\n";
 
-    for (auto it = obj.begin(); it != obj.end(); ++it) {
+    for (size_t i = 0; i < obj.size(); i++) {
+        const object_t::value_type& member = sorted.empty() ? obj.data()[i] : *sorted[i];
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += "\"" + json_escape(it->first) + "\":";
+        s += "\"" + json_escape(member.first) + "\":";
         if (prettyIndent)
             s += " ";
-        s += it->second.write(prettyIndent, indentLevel + 1);
-        auto tmpit = it;
-        tmpit++;
-        if (tmpit != obj.end())
+        s += member.second.write(prettyIndent, indentLevel + 1, order);
+        if (i != (obj.size() - 1))
             s += ",";
         if (prettyIndent)
             s += "\n";
@@ -84,9 +96,9 @@ void writeString(const std::string& str, std::string& s)
     s += "\"" + json_escape(str) + "\"";
 }
 
-void writeNum(num_t num, std::string& s)
+void writeNum(const num_t& num, std::string& s)
 {
-    s += num.getValStr();
+    num.appendValStr(s);
 }
 
 void writeBool(bool val, std::string& s)
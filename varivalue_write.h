@@ -5,10 +5,10 @@
 #ifndef __VARIVALUE_WRITE_H__
 #define __VARIVALUE_WRITE_H__
 
-void writeArray(const array_t& arr, std::string& s, unsigned int prettyIndent, unsigned int indentLevel);
-void writeObject(const object_t& obj, std::string& s, unsigned int prettyIndent, unsigned int indentLevel);
+void writeArray(const array_t& arr, std::string& s, unsigned int prettyIndent, unsigned int indentLevel, VariValue::WriteOrder order);
+void writeObject(const object_t& obj, std::string& s, unsigned int prettyIndent, unsigned int indentLevel, VariValue::WriteOrder order);
 void writeString(const std::string& str, std::string& s);
-void writeNum(num_t num, std::string& s);
+void writeNum(const num_t& num, std::string& s);
 void writeBool(bool val, std::string& s);
 void writeNull(std::string& s);
 